@@ -0,0 +1,50 @@
+/**
+ *  /file guwhiteboardwebposter/alloc_stats.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include "alloc_stats.h"
+
+#ifdef ALLOC_STATS
+
+#include <cstddef>
+
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+}
+
+static __thread uint64_t allocations;   //no constructor, so it's safe to touch from inside malloc
+
+uint64_t alloc_stats_count(void)
+{
+    return allocations;
+}
+
+extern "C"
+{
+void *malloc(size_t size)
+{
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+}
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ *  /file guwhiteboardwebposter/alloc_stats.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stdint.h>
+
+/**
+ * Build with -DALLOC_STATS (glibc only) to count every heap allocation,
+ * C++ ones included since operator new goes through malloc, and log how
+ * many each request made.
+ */
+#ifdef ALLOC_STATS
+
+/** Allocations made by the calling thread so far. */
+uint64_t alloc_stats_count(void);
+
+#endif
+
+#endif //ALLOC_STATS_H
@@ -0,0 +1,132 @@
+/**
+ *  /file guwhiteboardwebposter/arena.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ((sizeof(arena_block) + ARENA_ALIGN - 1) & ~static_cast<size_t>(ARENA_ALIGN - 1))
+
+static inline size_t align(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~static_cast<size_t>(ARENA_ALIGN - 1);
+}
+
+static inline char *block_data(arena_block *b)
+{
+    return reinterpret_cast<char *>(b) + ARENA_HEADER;
+}
+
+void arena_init(arena *a)
+{
+    a->first = nullptr;
+    a->current = nullptr;
+    a->last = nullptr;
+}
+
+void arena_free(arena *a)
+{
+    arena_block *b = a->first;
+    while(b)
+    {
+        arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    arena_init(a);
+}
+
+void arena_reset(arena *a)
+{
+    for(arena_block *b = a->first; b; b = b->next)
+        b->used = 0;
+    a->current = a->first;
+    a->last = nullptr;
+}
+
+void *arena_alloc(arena *a, size_t size)
+{
+    size = align(size == 0 ? 1 : size);
+    //an earlier, larger request may have left a block that fits further along the chain
+    arena_block *b = a->current;
+    while(b && b->size - b->used < size)
+        b = b->next;
+    if(!b)
+    {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        b = static_cast<arena_block *>(malloc(ARENA_HEADER + block_size));
+        if(!b)
+            return nullptr;
+        b->next = nullptr;
+        b->size = block_size;
+        b->used = 0;
+        if(!a->first)
+            a->first = b;
+        else
+        {
+            arena_block *tail = a->current ? a->current : a->first;
+            while(tail->next)
+                tail = tail->next;
+            tail->next = b;
+        }
+    }
+    a->current = b;
+    void *p = block_data(b) + b->used;
+    b->used += size;
+    a->last = p;
+    return p;
+}
+
+void *arena_grow(arena *a, void *ptr, size_t old_size, size_t new_size)
+{
+    if(ptr && ptr == a->last)
+    {
+        arena_block *b = a->current;
+        size_t start = static_cast<size_t>(static_cast<char *>(ptr) - block_data(b));
+        if(start + align(new_size) <= b->size)
+        {
+            b->used = start + align(new_size);
+            return ptr;
+        }
+    }
+    void *p = arena_alloc(a, new_size);
+    if(p && ptr)
+        memcpy(p, ptr, old_size);
+    return p;
+}
+
+void arena_text_init(arena_text *t, arena *a)
+{
+    t->a = a;
+    t->data = nullptr;
+    t->length = 0;
+    t->capacity = 0;
+}
+
+char *arena_text_reserve(arena_text *t, size_t n)
+{
+    if(t->capacity - t->length < n)
+    {
+        size_t capacity = t->capacity < 256 ? 256 : t->capacity * 2;
+        while(capacity - t->length < n)
+            capacity *= 2;
+        char *data = static_cast<char *>(arena_grow(t->a, t->data, t->length, capacity));
+        if(!data)
+            abort(); //out of memory, same as std::string would
+        t->data = data;
+        t->capacity = capacity;
+    }
+    return t->data + t->length;
+}
+
+void arena_text_append(arena_text *t, const char *data, size_t length)
+{
+    memcpy(arena_text_reserve(t, length), data, length);
+    t->length += length;
+}
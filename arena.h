@@ -0,0 +1,74 @@
+/**
+ *  /file guwhiteboardwebposter/arena.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstring>
+
+#define ARENA_BLOCK_SIZE 16384  ///< smallest block, larger requests get a block of their own size
+
+typedef struct arena_block_s
+{
+    struct arena_block_s *next;
+    size_t size;            ///< usable bytes after the header
+    size_t used;
+} arena_block;
+
+/**
+ * Per connection scratch memory for building a response.
+ *
+ * Allocation bumps a pointer through a chain of blocks and nothing is freed
+ * individually; arena_reset() makes all of it available again once the
+ * response has been queued.  The blocks are kept, so after the first few
+ * requests a connection stops touching the heap.
+ */
+typedef struct arena_s
+{
+    arena_block *first;
+    arena_block *current;   ///< block allocations currently come from
+    void *last;             ///< most recent allocation, the only one that can grow in place
+} arena;
+
+void arena_init(arena *a);
+void arena_free(arena *a);
+
+/** Forgets every allocation but keeps the memory. */
+void arena_reset(arena *a);
+
+/** size bytes aligned for any type, nullptr if the heap is exhausted. */
+void *arena_alloc(arena *a, size_t size);
+
+/**
+ * Resizes the most recent allocation in place if there is room, otherwise
+ * moves it to a new allocation.  'ptr' may be nullptr.
+ */
+void *arena_grow(arena *a, void *ptr, size_t old_size, size_t new_size);
+
+/** text built up in an arena */
+typedef struct arena_text_s
+{
+    arena *a;
+    char *data;             ///< not NUL terminated
+    size_t length;
+    size_t capacity;
+} arena_text;
+
+void arena_text_init(arena_text *t, arena *a);
+void arena_text_append(arena_text *t, const char *data, size_t length);
+inline void arena_text_append_str(arena_text *t, const char *s) { arena_text_append(t, s, strlen(s)); }
+
+/**
+ * Makes room for at least n more bytes and returns where they go, for
+ * writing into directly before calling arena_text_commit().
+ */
+char *arena_text_reserve(arena_text *t, size_t n);
+inline void arena_text_commit(arena_text *t, size_t n) { t->length += n; }
+
+#endif //ARENA_H
@@ -0,0 +1,173 @@
+/**
+ *  /file guwhiteboardwebposter/assets.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <stdint.h>
+
+#include "assets.h"
+#include "compress.h"
+
+static const char app_js[] = R"JS(var monitor = null;
+function whiteboardMonitor() {
+	if(monitor) monitor.close();
+	monitor = null;
+	var types = [];
+	var checkboxes = document.getElementsByName('wbmonitor');
+	for(var i=0, n=checkboxes.length;i<n;i++) {
+		if(checkboxes[i].checked)
+			types.push(checkboxes[i].id.substring(4, checkboxes[i].id.length));
+	}
+	if(types.length == 0)
+		return;
+	var url = types.length == checkboxes.length ? '/events' : '/events?types=' + types.map(encodeURIComponent).join(',');
+	monitor = new EventSource(url);
+	types.forEach(function(type) {
+		monitor.addEventListener(type, function(e) {
+			var cell = document.getElementById(type);
+			if(cell) cell.textContent = e.data;
+		});
+	});
+}
+function handleClick(cb) {
+	whiteboardMonitor();
+}
+function toggleAll(source) {
+	var checkboxes = document.getElementsByName('wbmonitor');
+	for(var i=0, n=checkboxes.length;i<n;i++) {
+		checkboxes[i].checked = source.checked;
+	}
+	whiteboardMonitor();
+}
+function submitJSON(e) {
+	var value = encodeURIComponent(document.getElementById('textarea').value);
+	var params = "{ \"value\":\"" + value + "\" }";
+	e.preventDefault();
+	var xhttp = new XMLHttpRequest();
+	xhttp.onreadystatechange = function() {
+		if(this.readyState != 4)
+			return;
+		if(this.status == 200 || this.status == 202) {
+			var arr = JSON.parse(this.responseText);
+			if(this.status == 200) //202 only says it was queued, the value isn't read back
+				document.getElementById('textarea').value = arr.value;
+			document.getElementById('submit').className = 'posted';
+			setTimeout(resetButton, 500);
+		}
+		else {
+			document.getElementById('submit').className = 'failed';
+			setTimeout(resetButton, 2000);
+		}
+	};
+	xhttp.open("POST", window.location.pathname, true);
+	xhttp.setRequestHeader("Content-Type", "application/vnd.api+json");
+	xhttp.setRequestHeader("Accept", "application/vnd.api+json");
+	xhttp.send(params);
+	return false;
+}
+function resetButton() {
+	document.getElementById('submit').className = '';
+}
+document.addEventListener('DOMContentLoaded', function() {
+	var form = document.getElementById('form');
+	if(form) form.addEventListener('submit', submitJSON);
+});
+)JS";
+
+static const char app_css[] = R"CSS(body { background-color: #FFFFFF }
+#form div { width: 50%; }
+#form textarea { width: 100%; }
+#form .buttons { text-align: right; }
+#submit.posted { background-color: #00FF00; }
+#submit.failed { background-color: #FF0000; }
+)CSS";
+
+static static_asset assets[] =
+{
+    { "/app.js", "application/javascript", app_js, sizeof(app_js) - 1, {}, "", {} },
+    { "/app.css", "text/css", app_css, sizeof(app_css) - 1, {}, "", {} }
+};
+
+#define NUM_ASSETS (sizeof(assets) / sizeof(assets[0]))
+
+static std::string page_head;
+static std::string page_tail = "</body></html>\r\n";
+
+void assets_init(void)
+{
+    for(size_t i = 0; i < NUM_ASSETS; i++)
+    {
+        //FNV-1a, only needs to change when the content does
+        uint64_t hash = 14695981039346656037ULL;
+        for(size_t b = 0; b < assets[i].length; b++)
+        {
+            hash ^= static_cast<unsigned char>(assets[i].body[b]);
+            hash *= 1099511628211ULL;
+        }
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        //each representation is a different body, so it needs its own strong ETag
+        for(int e = Encoding_Identity; e < NUM_CONTENT_ENCODINGS; e++)
+            assets[i].etag[e] = std::string("\"") + hex + Content_Encoding_ETag_Suffixes[e] + "\"";
+        assets[i].url = std::string(assets[i].path) + "?v=" + hex;
+
+        for(int e = Encoding_Identity + 1; e < NUM_CONTENT_ENCODINGS; e++)
+        {
+            std::string *encoded = &assets[i].encoded[e];
+            if(!compress_buffer(static_cast<enum Content_Encoding>(e), COMPRESS_STATIC_LEVEL, assets[i].body, assets[i].length, encoded) ||
+               encoded->length() >= assets[i].length)
+                encoded->clear();
+        }
+    }
+
+    page_head = "<!DOCTYPE html><html><head><title>guwhiteboardwebposter</title>\r\n"
+                "<link rel='stylesheet' href='" + assets[1].url + "'>\r\n"
+                "<script src='" + assets[0].url + "' defer></script>\r\n"
+                "</head><body>\r\n";
+}
+
+const static_asset *find_asset(http_string path)
+{
+    for(size_t i = 0; i < NUM_ASSETS; i++)
+        if(http_string_equals(path, assets[i].path))
+            return &assets[i];
+    return nullptr;
+}
+
+const std::string &html_page_head(void)
+{
+    return page_head;
+}
+
+const std::string &html_page_tail(void)
+{
+    return page_tail;
+}
+
+void handle_asset(struct connection_s *conn, struct header_info_s *header, const static_asset *asset)
+{
+    enum Content_Encoding encoding = asset->encoded[header->accept_encoding].empty() ? Encoding_Identity : header->accept_encoding;
+    char headers[160];
+    snprintf(headers, sizeof(headers), "ETag: %s\r\n" ASSET_CACHE_CONTROL "Vary: Accept-Encoding\r\n", asset->etag[encoding].c_str());
+    const http_string *if_none_match = http_find_field(&header->request, "If-None-Match");
+    if(if_none_match && http_etag_matches(*if_none_match, asset->etag[encoding].c_str()))
+    {
+        generate_response_parts(conn, header->version, _304_Not_Modified, asset->content_type, nullptr, 0, headers, false);
+        return;
+    }
+    body_part body = { asset->body, asset->length, true };
+    if(encoding != Encoding_Identity)
+    {
+        body.data = asset->encoded[encoding].data();
+        body.length = asset->encoded[encoding].length();
+        size_t used = strlen(headers);
+        snprintf(headers + used, sizeof(headers) - used, "Content-Encoding: %s\r\n", Content_Encoding_Strings[encoding]);
+    }
+    generate_response_parts(conn, header->version, _200_OK, asset->content_type, &body, 1, headers, false);
+}
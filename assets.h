@@ -0,0 +1,52 @@
+/**
+ *  /file guwhiteboardwebposter/assets.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <cstddef>
+#include <string>
+
+#include "guwhiteboardwebposter.h"
+
+#define ASSET_CACHE_CONTROL "Cache-Control: public, max-age=31536000, immutable\r\n" ///< asset URLs change with their content
+
+/** a file the HTML pages need, compiled in */
+typedef struct static_asset_s
+{
+    const char *path;           ///< e.g. '/app.js'
+    const char *content_type;
+    const char *body;
+    size_t length;
+    std::string etag[NUM_CONTENT_ENCODINGS]; ///< quoted hash of the body, suffixed for each compressed representation
+    std::string url;            ///< path with the hash as a query string, what the pages link to
+    std::string encoded[NUM_CONTENT_ENCODINGS]; ///< body compressed ahead of time, empty if it didn't help
+} static_asset;
+
+/** Hashes the assets and builds the page fragments that link to them. Call before any worker starts. */
+void assets_init(void);
+
+/** The asset served at path, or nullptr. */
+const static_asset *find_asset(http_string path);
+
+/**
+ * Everything up to and including '<body>' for the HTML pages.
+ * Built once, so responses can borrow it instead of copying.
+ */
+const std::string &html_page_head(void);
+
+/** Closes the page started by html_page_head(). */
+const std::string &html_page_tail(void);
+
+/**
+ * GET for an asset, answered from memory with a long lived Cache-Control,
+ * precompressed if the client takes it.
+ */
+void handle_asset(struct connection_s *conn, struct header_info_s *header, const static_asset *asset);
+
+#endif //ASSETS_H
@@ -0,0 +1,131 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+#include <vector>
+
+#include "guwhiteboardwebposter.h" //optargs
+#include "json.h"
+
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 1000000
+#define DEFAULT_CONCURRENCY 8
+#define DEFAULT_LOAD_SECONDS 5
+
+static std::vector<bench_result> results;
+
+void bench_record(const bench_result &result)
+{
+    results.push_back(result);
+}
+
+static void append_number(std::string *out, const char *name, double value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), ",\"%s\":%.1f", name, value);
+    out->append(buffer);
+}
+
+bool bench_write_json(const char *path, uint64_t iterations)
+{
+    std::string out;
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "{\"iterations\":%llu,\"results\":[", static_cast<unsigned long long>(iterations));
+    out.append(buffer);
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const bench_result &r = results[i];
+        out.append(i == 0 ? "\n{\"name\":" : ",\n{\"name\":");
+        json_append_string(&out, r.name.c_str());
+        out.append(",\"unit\":");
+        json_append_string(&out, r.unit.c_str());
+        append_number(&out, "rate", r.rate);
+        append_number(&out, "ns_per_op", r.ns_per_op);
+        if(r.concurrency > 0)
+        {
+            snprintf(buffer, sizeof(buffer), ",\"concurrency\":%d,\"errors\":%llu", r.concurrency, static_cast<unsigned long long>(r.errors));
+            out.append(buffer);
+            append_number(&out, "p50_us", r.p50_us);
+            append_number(&out, "p99_us", r.p99_us);
+            append_number(&out, "p999_us", r.p999_us);
+        }
+        out.append("}");
+    }
+    out.append("\n]}\n");
+
+    FILE *f = fopen(path, "w");
+    if(!f)
+    {
+        perror(path);
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.length(), f) == out.length();
+    return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t iterations = DEFAULT_ITERATIONS;
+    const char *json_path = nullptr;
+    int load_port = 0;
+    int concurrency = DEFAULT_CONCURRENCY;
+    int seconds = DEFAULT_LOAD_SECONDS;
+
+    int c;
+    while((c = getopt(argc, argv, "c:d:j:l:")) != -1)
+    {
+        switch(c)
+        {
+            case 'c':
+                concurrency = atoi(optarg);
+                break;
+            case 'd':
+                seconds = atoi(optarg);
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            case 'l':
+                load_port = atoi(optarg);
+                break;
+            default:
+                concurrency = 0;
+                break;
+        }
+    }
+    if(optind < argc)
+        iterations = strtoull(argv[optind], nullptr, 10);
+    if(iterations == 0 || concurrency <= 0 || seconds <= 0 || load_port < 0)
+    {
+        fprintf(stderr, "Usage: guwhiteboardwebposter_bench [-j results.json] [-l port [-c concurrency] [-d seconds]] [iterations]\n");
+        fprintf(stderr, "-j\twrite the results as JSON to a file, to compare runs across commits\n");
+        fprintf(stderr, "-l\tinstead of the microbenchmarks, load test a poster listening on 127.0.0.1:port\n");
+        fprintf(stderr, "-c\tconnections the load test keeps busy, default: %d\n", DEFAULT_CONCURRENCY);
+        fprintf(stderr, "-d\tseconds each kind of request is load tested for, default: %d\n", DEFAULT_LOAD_SECONDS);
+        return EXIT_FAILURE;
+    }
+
+    if(load_port != 0)
+    {
+        if(!bench_load(load_port, concurrency, seconds))
+            return EXIT_FAILURE;
+    }
+    else
+    {
+        bench_parser(iterations);
+        bench_lookup(iterations);
+        bench_render(iterations);
+        bench_json(iterations);
+        bench_percent(iterations);
+    }
+
+    if(json_path && !bench_write_json(json_path, iterations))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include <stdint.h>
+
+/** one measurement, collected for the JSON report */
+typedef struct bench_result_s
+{
+    std::string name;
+    std::string unit;
+    double rate;                ///< operations per second
+    double ns_per_op;           ///< mean time per operation
+    int concurrency;            ///< connections used by a load run, 0 for microbenchmarks
+    uint64_t errors;            ///< failed requests in a load run
+    double p50_us;              ///< latency percentiles of a load run, in microseconds
+    double p99_us;
+    double p999_us;
+} bench_result;
+
+/** Adds a result to the report written by bench_write_json(). */
+void bench_record(const bench_result &result);
+
+/** Writes every recorded result as a JSON document, returns false if 'path' can't be written. */
+bool bench_write_json(const char *path, uint64_t iterations);
+
+/** keeps the optimiser from discarding a benchmark's result */
+template<typename T> inline void bench_keep(const T &value)
+{
+    __asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Times 'iterations' calls of fn, after a short warm up, and prints the rate.
+ * Each call counts as 'units_per_call' units, e.g. the MB a call processes.
+ * Returns units per second.
+ */
+template<typename F> double bench_run(const char *name, const char *unit, uint64_t iterations, F fn, double units_per_call = 1)
+{
+    for(uint64_t i = 0; i < iterations / 10; i++)
+        fn();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint64_t i = 0; i < iterations; i++)
+        fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double calls = static_cast<double>(iterations);
+    double rate = calls * units_per_call / elapsed.count();
+    double ns_per_op = elapsed.count() * 1e9 / calls;
+    fprintf(stdout, "%-40s %14.0f %s/s %10.1f ns/op\n", name, rate, unit, ns_per_op);
+    bench_result result = bench_result();
+    result.name = name;
+    result.unit = unit;
+    result.rate = rate;
+    result.ns_per_op = ns_per_op;
+    bench_record(result);
+    return rate;
+}
+
+//benchmark groups
+void bench_parser(uint64_t iterations);
+void bench_lookup(uint64_t iterations);
+void bench_render(uint64_t iterations);
+void bench_json(uint64_t iterations);
+void bench_percent(uint64_t iterations);
+
+/**
+ * Loopback load generator, drives a running poster on 127.0.0.1:port with
+ * 'concurrency' keep-alive connections for 'seconds' per request kind.
+ */
+bool bench_load(int port, int concurrency, int seconds);
+
+#endif //BENCH_H
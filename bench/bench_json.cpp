@@ -0,0 +1,119 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench_json.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstring>
+#include <string>
+
+#include "bench.h"
+#include "json.h"
+
+/** message values of the sort the whiteboard holds */
+typedef struct json_sample_s
+{
+    const char *name;
+    std::string value;
+} json_sample;
+
+/** the byte at a time loop json_append_string() used before it scanned 16 bytes at once */
+static void legacy_append_string(std::string *out, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out->push_back('"');
+    const char *run = s;
+    for(const char *p = s; *p != '\0'; p++)
+    {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if(c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out->append(run, static_cast<size_t>(p - run));
+        run = p + 1;
+        switch(c)
+        {
+            case '"': out->append("\\\"", 2); break;
+            case '\\': out->append("\\\\", 2); break;
+            case '\n': out->append("\\n", 2); break;
+            case '\r': out->append("\\r", 2); break;
+            case '\t': out->append("\\t", 2); break;
+            default:
+            {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                out->append(escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    out->append(run);
+    out->push_back('"');
+}
+
+/** Reads a {"value":...} body back, the way a POST to a message is read. */
+static bool read_body(json_reader *reader, const std::string &body)
+{
+    json_reader_init(reader, body.data(), body.length());
+    return json_reader_next(reader) == JSON_OBJECT_BEGIN
+        && json_reader_next(reader) == JSON_NAME
+        && json_reader_next(reader) == JSON_STRING
+        && json_reader_next(reader) == JSON_OBJECT_END
+        && json_reader_next(reader) == JSON_END;
+}
+
+void bench_json(uint64_t iterations)
+{
+    json_sample samples[4];
+    samples[0].name = "Speech";
+    samples[0].value = "Hello, my name is Nao. I am standing up now, please stand back.";
+    samples[1].name = "motion command";
+    samples[1].value = "HeadPitch=0.25,HeadYaw=-0.10,LShoulderPitch=1.40,LShoulderRoll=0.30,RShoulderPitch=1.40,"
+                       "RShoulderRoll=-0.30,LHipPitch=-0.45,RHipPitch=-0.45,LKneePitch=0.90,RKneePitch=0.90,Stiffness=1.0";
+    samples[2].name = "log lines with quotes";
+    for(int i = 0; i < 8; i++)
+        samples[2].value += "vision: \"ball\" at (120, 45) r=12, \"goal\" post at (300, 80)\tconfidence 0.87\n";
+    samples[3].name = "4KB plain report";
+    while(samples[3].value.length() < 4096)
+        samples[3].value += "frame 1024 segments 312 lines 18 ball none goal left 0.42 right 0.58 horizon 212 ";
+
+    std::string escaped;
+    json_reader reader;
+    for(size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+    {
+        const json_sample &sample = samples[i];
+        const char *value = sample.value.c_str();
+        size_t length = sample.value.length();
+        double mb = static_cast<double>(length) / 1e6;
+        uint64_t n = iterations / 10 + 1;
+
+        //both directions have to round trip, and agree with the old writer, before they're timed
+        std::string legacy;
+        legacy_append_string(&legacy, value);
+        escaped.clear();
+        json_append_string(&escaped, value, length);
+        std::string body = "{\"value\":" + escaped + "}";
+        if(escaped != legacy || !read_body(&reader, body) || reader.text != sample.value)
+        {
+            fprintf(stderr, "json round trip failed for '%s'\n", sample.name);
+            continue;
+        }
+
+        std::string title = std::string("json escape ") + sample.name;
+        bench_run(title.c_str(), "MB", n, [&]() {
+            escaped.clear();
+            json_append_string(&escaped, value, length);
+            bench_keep(escaped);
+        }, mb);
+        title = std::string("legacy json escape ") + sample.name;
+        bench_run(title.c_str(), "MB", n, [&]() {
+            escaped.clear();
+            legacy_append_string(&escaped, value);
+            bench_keep(escaped);
+        }, mb);
+        title = std::string("json read ") + sample.name;
+        bench_run(title.c_str(), "MB", n, [&]() {
+            bench_keep(read_body(&reader, body));
+        }, static_cast<double>(body.length()) / 1e6);
+    }
+}
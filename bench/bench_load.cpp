@@ -0,0 +1,261 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench_load.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "request_body.h"
+
+#define LOAD_RECV_SIZE (64 * 1024)
+#define LOAD_MAX_RESPONSE_BODY (64 * 1024 * 1024)
+
+/** one kind of request the load generator sends */
+typedef struct load_request_s
+{
+    const char *name;
+    std::string text;           ///< the whole request, header and body
+} load_request;
+
+/** a keep-alive connection to the poster, owned by one thread */
+typedef struct load_client_s
+{
+    int fd;
+    std::string in;             ///< received bytes not yet part of a response
+    request_body body;          ///< decodes the response body, whichever framing it has
+} load_client;
+
+/** what one thread measured */
+typedef struct load_worker_s
+{
+    std::vector<uint32_t> latencies;    ///< microseconds per request
+    uint64_t errors;
+} load_worker;
+
+static int load_connect(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0)
+        return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool load_send(int fd, const std::string &text)
+{
+    size_t sent = 0;
+    while(sent < text.length())
+    {
+        ssize_t n = send(fd, text.data() + sent, text.length() - sent, 0);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool load_recv(load_client *c)
+{
+    char buffer[LOAD_RECV_SIZE];
+    ssize_t n;
+    do
+        n = recv(c->fd, buffer, sizeof(buffer), 0);
+    while(n < 0 && errno == EINTR);
+    if(n <= 0)
+        return false;
+    c->in.append(buffer, static_cast<size_t>(n));
+    return true;
+}
+
+/** Case insensitive check for 'name: value' in a response header. */
+static const char *load_field(const std::string &header, const char *name)
+{
+    size_t length = strlen(name);
+    for(size_t line = header.find("\r\n"); line != std::string::npos && line + 2 < header.length(); line = header.find("\r\n", line + 2))
+        if(strncasecmp(header.c_str() + line + 2, name, length) == 0 && header[line + 2 + length] == ':')
+            return header.c_str() + line + 3 + length;
+    return nullptr;
+}
+
+/**
+ * Reads one response, returns false if the connection failed.
+ * 'ok' is whether it was a 2xx, 'closing' whether the server is closing the connection after it.
+ */
+static bool load_response(load_client *c, bool *ok, bool *closing)
+{
+    size_t header_end;
+    while((header_end = c->in.find("\r\n\r\n")) == std::string::npos)
+        if(!load_recv(c))
+            return false;
+    std::string header = c->in.substr(0, header_end + 2);
+    c->in.erase(0, header_end + 4);
+
+    *ok = header.length() > 9 && header[9] == '2';
+    const char *connection = load_field(header, "Connection");
+    *closing = connection && strncasecmp(connection + strspn(connection, " "), "close", 5) == 0;
+    const char *length = load_field(header, "Content-Length");
+    const char *encoding = load_field(header, "Transfer-Encoding");
+    const char *chunked_token = encoding ? strstr(encoding, "chunked") : nullptr;
+    bool chunked = chunked_token && chunked_token < strstr(encoding, "\r\n");
+    if(!chunked && !length && *closing)
+    {   //the body ends with the connection
+        while(load_recv(c)) {}
+        c->in.clear();
+        return true;
+    }
+
+    enum Body_Status status = request_body_begin(&c->body, chunked, length ? atoi(length) : 0, LOAD_MAX_RESPONSE_BODY);
+    while(status == BODY_MORE)
+    {
+        size_t used = 0;
+        status = request_body_feed(&c->body, c->in.data(), c->in.length(), &used);
+        c->in.erase(0, used);
+        if(status == BODY_MORE && !load_recv(c))
+            return false;
+    }
+    request_body_reset(&c->body);
+    return status == BODY_DONE;
+}
+
+static void load_worker_run(int port, const load_request *request, std::atomic<bool> *running, load_worker *worker)
+{
+    load_client c;
+    c.fd = -1;
+    request_body_reset(&c.body);
+    while(running->load(std::memory_order_relaxed))
+    {
+        if(c.fd < 0)
+        {
+            c.fd = load_connect(port);
+            c.in.clear();
+            if(c.fd < 0)
+            {
+                worker->errors++;
+                usleep(1000);
+                continue;
+            }
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool ok = false;
+        bool closing = false;
+        bool received = load_send(c.fd, request->text) && load_response(&c, &ok, &closing);
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+        if(received && ok)
+            worker->latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        else
+            worker->errors++;
+        if(!received || closing)
+        {
+            close(c.fd);
+            c.fd = -1;
+        }
+    }
+    if(c.fd >= 0)
+        close(c.fd);
+}
+
+static double percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    if(sorted.empty())
+        return 0;
+    size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static bool load_run(int port, int concurrency, int seconds, const load_request *request)
+{
+    std::atomic<bool> running(true);
+    std::vector<load_worker> workers(static_cast<size_t>(concurrency));
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].errors = 0;
+        threads.push_back(std::thread(load_worker_run, port, request, &running, &workers[i]));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running.store(false);
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    bench_result result = bench_result();
+    result.name = std::string("load ") + request->name;
+    result.unit = "req";
+    result.concurrency = concurrency;
+    std::vector<uint32_t> latencies;
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        latencies.insert(latencies.end(), workers[i].latencies.begin(), workers[i].latencies.end());
+        result.errors += workers[i].errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.rate = static_cast<double>(latencies.size()) / elapsed.count();
+    result.ns_per_op = latencies.empty() ? 0 : 1e9 / result.rate;
+    result.p50_us = percentile(latencies, 0.50);
+    result.p99_us = percentile(latencies, 0.99);
+    result.p999_us = percentile(latencies, 0.999);
+    fprintf(stdout, "%-40s %14.0f req/s  p50 %7.0f us  p99 %7.0f us  p99.9 %7.0f us  %llu errors\n",
+            result.name.c_str(), result.rate, result.p50_us, result.p99_us, result.p999_us, static_cast<unsigned long long>(result.errors));
+    bench_record(result);
+    return !latencies.empty();
+}
+
+bool bench_load(int port, int concurrency, int seconds)
+{
+    static const char post_body[] = "{\"value\":\"bench\"}";
+    char post_length[32];
+    snprintf(post_length, sizeof(post_length), "%zu", sizeof(post_body) - 1);
+
+    load_request requests[3];
+    requests[0].name = "GET single";
+    requests[0].text = "GET /Print HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: application/json\r\n\r\n";
+    requests[1].name = "GET listing";
+    requests[1].text = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: application/json\r\n\r\n";
+    requests[2].name = "POST";
+    requests[2].text = std::string("POST /Print HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: application/json\r\nContent-Type: application/json\r\nContent-Length: ")
+                     + post_length + "\r\n\r\n" + post_body;
+
+    signal(SIGPIPE, SIG_IGN); //a connection the server closed shows up as a failed send
+    fprintf(stdout, "load testing 127.0.0.1:%d with %d connections, %d s per request\n", port, concurrency, seconds);
+    bool ok = true;
+    for(size_t i = 0; i < sizeof(requests) / sizeof(requests[0]); i++)
+        if(!load_run(port, concurrency, seconds, &requests[i]))
+        {
+            fprintf(stderr, "no '%s' request succeeded, is the poster listening on %d?\n", requests[i].name, port);
+            ok = false;
+        }
+    return ok;
+}
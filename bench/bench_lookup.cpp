@@ -0,0 +1,67 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench_lookup.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstring>
+#include <vector>
+
+#include "guwhiteboardtypelist_generated.h"
+
+#include "bench.h"
+#include "name_index.h"
+
+/** what wb_find_type() used to do, a strncmp() down the type list */
+static int linear_find_type(const char *name, size_t length)
+{
+    for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+        if(strncmp(WBTypes_stringValues[i], name, length) == 0 && WBTypes_stringValues[i][length] == '\0')
+            return i;
+    return -1;
+}
+
+void bench_lookup(uint64_t iterations)
+{
+    name_index index;
+    name_index_build(&index, WBTypes_stringValues, GSW_NUM_TYPES_DEFINED);
+    fprintf(stdout, "%d types, %zu slots, seed %u\n", GSW_NUM_TYPES_DEFINED, index.slots.size(), index.seed);
+
+    //every lookup has to agree with the scan before either is timed
+    for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+    {
+        const char *name = WBTypes_stringValues[i];
+        if(name_index_find(&index, name, strlen(name)) != linear_find_type(name, strlen(name)))
+        {
+            fprintf(stderr, "name_index disagrees with the linear scan for '%s'\n", name);
+            return;
+        }
+    }
+
+    //one call looks up every type name, so rates are per full sweep
+    std::vector<size_t> lengths;
+    for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+        lengths.push_back(strlen(WBTypes_stringValues[i]));
+    uint64_t sweeps = iterations / GSW_NUM_TYPES_DEFINED + 1;
+    double linear = bench_run("lookup all types, linear strncmp", "sweeps", sweeps, [&]()
+    {
+        for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+            bench_keep(linear_find_type(WBTypes_stringValues[i], lengths[static_cast<size_t>(i)]));
+    });
+    double hashed = bench_run("lookup all types, perfect hash", "sweeps", sweeps, [&]()
+    {
+        for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+            bench_keep(name_index_find(&index, WBTypes_stringValues[i], lengths[static_cast<size_t>(i)]));
+    });
+    bench_run("lookup unknown name, linear strncmp", "lookups", iterations, [&]()
+    {
+        bench_keep(linear_find_type("NotAWhiteboardType", 18));
+    });
+    bench_run("lookup unknown name, perfect hash", "lookups", iterations, [&]()
+    {
+        bench_keep(name_index_find(&index, "NotAWhiteboardType", 18));
+    });
+    fprintf(stdout, "perfect hash is %.1fx the linear scan over all types\n", hashed / linear);
+}
@@ -0,0 +1,147 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench_parser.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "http_parser.h"
+
+/** what a browser sends when loading the monitor page */
+static const char browser_get[] =
+    "GET / HTTP/1.1\r\n"
+    "Host: robot.local:4242\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-AU,en;q=0.9\r\n"
+    "\r\n";
+
+/** what the message page's submit button sends */
+static const char xhr_post[] =
+    "POST /Speech HTTP/1.1\r\n"
+    "Host: robot.local:4242\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 27\r\n"
+    "Accept: application/vnd.api+json\r\n"
+    "Content-Type: application/vnd.api+json\r\n"
+    "Origin: http://robot.local:4242\r\n"
+    "Referer: http://robot.local:4242/Speech\r\n"
+    "\r\n";
+
+/** a scripted client */
+static const char curl_get[] =
+    "GET /Speech HTTP/1.1\r\n"
+    "Host: robot.local:4242\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+//The parser this replaced, kept here as the reference point
+//--------------------
+static std::vector<std::string> legacy_split(const std::string &s, char separator)
+{
+    std::vector<std::string> components;
+    std::stringstream ss(s);
+    std::string component;
+    while(std::getline(ss, component, separator))
+        components.push_back(component);
+    return components;
+}
+
+static bool legacy_get_header_line(char *header, const char *field, char *output)
+{
+    std::string header_str = std::string(header);
+    std::string target = std::string(field).append(": ");
+    size_t index = header_str.find(target);
+    if(index == std::string::npos)
+        return false;
+    unsigned long start_value_pos = index + target.length();
+    unsigned long end_value_pos = header_str.find("\r\n", start_value_pos);
+    std::string value = header_str.substr(start_value_pos, end_value_pos - start_value_pos);
+    memcpy(output, value.c_str(), sizeof(char)*value.length());
+    return value.length() > 0;
+}
+
+static int legacy_parse_content_type(char *content_type)
+{
+    std::vector<std::string> types = legacy_split(content_type, ',');
+    for(size_t t = 0; t < types.size(); t++)
+        for(int i = 0; i < NUM_SUPPORTED_CONTENT_TYPES; i++)
+            if(strcmp(types[t].c_str(), Content_Type_Strings[i]) == 0)
+                return i;
+    return NUM_SUPPORTED_CONTENT_TYPES;
+}
+
+static bool legacy_parse_header(char *header)
+{
+    std::string header_str = std::string(header);
+    std::string first = header_str.substr(0, header_str.find("\r\n"));
+    char verb[7]; memset(&verb[0], 0, sizeof(verb));
+    char url[100]; memset(&url[0], 0, sizeof(url));
+    char http_ver[100]; memset(&http_ver[0], 0, sizeof(http_ver));
+    if(sscanf(header, "%6s %99s %99s", verb, url, http_ver) != 3)
+        return false;
+    char accept[256]; memset(&accept[0], 0, sizeof(accept));
+    if(!legacy_get_header_line(header, "Accept", accept))
+        return false;
+    legacy_parse_content_type(&accept[0]);
+    char content_type[100]; memset(&content_type[0], 0, sizeof(content_type));
+    if(legacy_get_header_line(header, "Content-Type", content_type))
+        legacy_parse_content_type(&content_type[0]);
+    char content_length[100]; memset(&content_length[0], 0, sizeof(content_length));
+    if(legacy_get_header_line(header, "Content-Length", content_length))
+        bench_keep(atoi(content_length));
+    return true;
+}
+//--------------------
+
+static void bench_request(const char *name, const char *request, uint64_t iterations)
+{
+    size_t length = strlen(request);
+    std::string title = std::string("parse_header ") + name;
+    struct header_info_s header;
+    bench_run(title.c_str(), "req", iterations, [&]() {
+        bool ok = parse_header(request, length, &header);
+        bench_keep(ok);
+        bench_keep(header);
+    });
+
+    std::string legacy_title = std::string("legacy parse_header ") + name;
+    std::string copy(request);
+    bench_run(legacy_title.c_str(), "req", iterations, [&]() {
+        bool ok = legacy_parse_header(&copy[0]);
+        bench_keep(ok);
+    });
+}
+
+static void bench_content_type(const char *name, const char *value, uint64_t iterations)
+{
+    http_string s = {value, strlen(value)};
+    std::string title = std::string("parse_content_type ") + name;
+    bench_run(title.c_str(), "values", iterations, [&]() {
+        bench_keep(parse_content_type(s));
+    });
+}
+
+void bench_parser(uint64_t iterations)
+{
+    bench_request("browser GET", browser_get, iterations);
+    bench_request("XHR POST", xhr_post, iterations);
+    bench_request("curl GET", curl_get, iterations);
+
+    bench_content_type("browser Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8", iterations);
+    bench_content_type("XHR Accept", "application/vnd.api+json", iterations);
+    bench_content_type("wildcard", "*/*", iterations);
+}
@@ -0,0 +1,144 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench_percent.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "percent.h"
+
+#define FUZZ_CASES 200000
+#define FUZZ_MAX_LENGTH 100
+
+//The decoder percent_decode() replaced, kept here as the reference point
+//https://www.rosettacode.org/wiki/URL_decoding#C
+//--------------------
+inline int ishex(int x)
+{
+	return	(x >= '0' && x <= '9')	||
+		(x >= 'a' && x <= 'f')	||
+		(x >= 'A' && x <= 'F');
+}
+
+static int legacy_decode(const char *s, char *dec)
+{
+	char *o;
+	const char *end = s + strlen(s);
+	int c;
+
+	for (o = dec; s <= end; o++) {
+		c = *s++;
+		if (c == '+') c = ' ';
+		else if (c == '%' && (	!ishex(*s++)	||
+					!ishex(*s++)	||
+					!sscanf(s - 2, "%2x", &c)))
+			return -1;
+
+		if (dec) *o = static_cast<char>(c);
+	}
+
+	return static_cast<int>(o - dec);
+}
+//--------------------
+
+/** what the message page's encodeURIComponent() sends */
+static std::string encode_component(const std::string &s)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    for(size_t i = 0; i < s.length(); i++)
+    {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if(isalnum(c) || (c != 0 && strchr("-_.!~*'()", c)))
+            out.push_back(static_cast<char>(c));
+        else
+        {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xf]);
+        }
+    }
+    return out;
+}
+
+/**
+ * Runs both decoders over random input, well formed or not, and checks
+ * they agree on whether it decodes and on what it decodes to.
+ */
+static bool fuzz_equivalence(void)
+{
+    static const char alphabet[] = "%%%+++0123456789abcdefABCDEFxyz \"\\\x01\x7f\x80\xff";
+    srand(42);
+    std::vector<char> legacy(3 * FUZZ_MAX_LENGTH + 2);
+    std::vector<char> decoded(3 * FUZZ_MAX_LENGTH + 2);
+    for(int i = 0; i < FUZZ_CASES; i++)
+    {
+        std::string input;
+        size_t length = static_cast<size_t>(rand() % FUZZ_MAX_LENGTH);
+        for(size_t j = 0; j < length; j++)
+            input.push_back(alphabet[rand() % (sizeof(alphabet) - 1)]);
+        if(i % 2 == 1)
+            input = encode_component(input); //half of them are well formed
+
+        int expected = legacy_decode(input.c_str(), &legacy[0]);
+        int result = percent_decode(input.data(), input.length(), &decoded[0], decoded.size());
+        //the legacy decoder counts the NUL it copies
+        bool agree = expected < 0 ? result < 0 : result == expected - 1 && memcmp(&legacy[0], &decoded[0], static_cast<size_t>(expected)) == 0;
+        if(!agree)
+        {
+            fprintf(stderr, "percent_decode disagrees with the legacy decoder on '%s': %d, %d\n", input.c_str(), result, expected - 1);
+            return false;
+        }
+
+        //one byte too few has to be caught, not overrun
+        if(result > 0 && percent_decode(input.data(), input.length(), &decoded[0], static_cast<size_t>(result)) != -1)
+        {
+            fprintf(stderr, "percent_decode ignored its buffer size on '%s'\n", input.c_str());
+            return false;
+        }
+    }
+    fprintf(stdout, "percent_decode agrees with the legacy decoder on %d random inputs\n", FUZZ_CASES);
+    return true;
+}
+
+void bench_percent(uint64_t iterations)
+{
+    if(!fuzz_equivalence())
+        return;
+
+    const char *names[] = { "Speech", "motion command", "4KB report" };
+    std::string values[3];
+    values[0] = "Hello, my name is Nao. I am standing up now, please stand back.";
+    values[1] = "HeadPitch=0.25,HeadYaw=-0.10,LShoulderPitch=1.40,LShoulderRoll=0.30,RShoulderPitch=1.40,"
+                "RShoulderRoll=-0.30,LHipPitch=-0.45,RHipPitch=-0.45,LKneePitch=0.90,RKneePitch=0.90,Stiffness=1.0";
+    while(values[2].length() < 4096)
+        values[2] += "frame_1024_segments_312_lines_18_ball_none_goal_left_0.42_right_0.58_horizon_212.";
+
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        std::string encoded = encode_component(values[i]);
+        std::vector<char> decoded(encoded.length() + 1);
+        double mb = static_cast<double>(encoded.length()) / 1e6;
+        uint64_t n = iterations / 10 + 1;
+
+        std::string title = std::string("percent_decode ") + names[i];
+        bench_run(title.c_str(), "MB", n, [&]() {
+            bench_keep(percent_decode(encoded.data(), encoded.length(), &decoded[0], decoded.size()));
+            bench_keep(decoded[0]);
+        }, mb);
+        title = std::string("legacy decode ") + names[i];
+        bench_run(title.c_str(), "MB", n, [&]() {
+            bench_keep(legacy_decode(encoded.c_str(), &decoded[0]));
+            bench_keep(decoded[0]);
+        }, mb);
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ *  /file guwhiteboardwebposter/bench/bench_render.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+
+#include "gusimplewhiteboard.h"
+
+#include "bench.h"
+#include "assets.h"
+#include "compress.h"
+#include "server.h"
+#include "wb_types.h"
+
+#define BENCH_WHITEBOARD_NAME "guwhiteboardwebposter_bench" ///< kept apart from the whiteboard a robot is using
+
+/**
+ * Runs one request through handle_request() the way the event loop does,
+ * producing all of a streamed body and writing the response to 'sink'.
+ */
+static void render(connection *conn, gu_simple_whiteboard_descriptor *wbd, char *body, int sink)
+{
+    conn->state = CONN_READING_HEADER;
+    conn->keep_alive = conn->header_info.keep_alive;
+    handle_request(conn, wbd, &conn->header_info, body);
+    write_queue_flush(&conn->out, sink);
+    while(conn->state == CONN_PRODUCING)
+    {
+        arena_reset(&conn->scratch);
+        response_stream_fill(conn, wbd);
+        write_queue_flush(&conn->out, sink);
+    }
+    arena_reset(&conn->scratch);
+}
+
+static void bench_page(connection *conn, gu_simple_whiteboard_descriptor *wbd, int sink, const char *name, const char *request, uint64_t iterations)
+{
+    std::string copy(request); //the parsed header points into it, and is reused for every iteration
+    if(!parse_header(copy.data(), copy.length(), &conn->header_info))
+    {
+        fprintf(stderr, "can't parse the request for '%s'\n", name);
+        return;
+    }
+    char body[1] = "";
+    std::string title = std::string("render ") + name;
+    bench_run(title.c_str(), "req", iterations, [&]() {
+        render(conn, wbd, body, sink);
+    });
+    if(conn->code != _200_OK)
+        fprintf(stderr, "'%s' was answered with %s\n", name, HTTP_Code_Strings[conn->code]);
+}
+
+void bench_render(uint64_t iterations)
+{
+    gu_simple_whiteboard_descriptor *wbd = gsw_new_whiteboard(BENCH_WHITEBOARD_NAME);
+    if(!wbd)
+    {
+        fprintf(stderr, "can't open the '%s' whiteboard, skipping the renderers\n", BENCH_WHITEBOARD_NAME);
+        return;
+    }
+    wb_types_init();
+    compress_init(DEFAULT_COMPRESSION_LEVEL);
+    assets_init();
+    int sink = open("/dev/null", O_WRONLY);
+
+    connection *conn = new connection();
+    conn->fd = sink;
+    conn->peer_closed = false;
+    conn->first_byte_sent = false;
+    conn->queued_at = 0;
+    conn->route = ROUTE_OTHER;
+    conn->code = UNKNOWN_HTTP_CODE;
+    conn->header_length = 0;
+    conn->body_start = 0;
+    request_body_reset(&conn->body);
+    write_queue_init(&conn->out);
+    arena_init(&conn->scratch);
+    conn->stream.produce = nullptr;
+
+    //a listing is much more work than one message, so it gets fewer iterations
+    uint64_t listings = iterations / 100 + 1;
+    bench_page(conn, wbd, sink, "HTML message", "GET /Print HTTP/1.1\r\nHost: bench\r\nAccept: text/html\r\n\r\n", iterations / 10 + 1);
+    bench_page(conn, wbd, sink, "JSON message", "GET /Print HTTP/1.1\r\nHost: bench\r\nAccept: application/json\r\n\r\n", iterations / 10 + 1);
+    bench_page(conn, wbd, sink, "HTML listing", "GET / HTTP/1.1\r\nHost: bench\r\nAccept: text/html\r\n\r\n", listings);
+    bench_page(conn, wbd, sink, "JSON listing", "GET / HTTP/1.1\r\nHost: bench\r\nAccept: application/json\r\n\r\n", listings);
+    bench_page(conn, wbd, sink, "JSON listing, gzip", "GET / HTTP/1.1\r\nHost: bench\r\nAccept: application/json\r\nAccept-Encoding: gzip\r\n\r\n", listings);
+
+    response_stream_end(&conn->stream);
+    arena_free(&conn->scratch);
+    delete conn;
+    close(sink);
+    gsw_free_whiteboard(wbd);
+}
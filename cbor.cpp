@@ -0,0 +1,194 @@
+/**
+ *  /file guwhiteboardwebposter/cbor.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "cbor.h"
+
+#define CBOR_UINT 0
+#define CBOR_NEGATIVE 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_SIMPLE 7
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_DOUBLE 27
+
+/**
+ * Writes a major type and its argument in the shortest form, into 'head'.
+ * Returns the number of bytes used, at most 9.
+ */
+static size_t encode_head(uint8_t *head, int major, uint64_t value)
+{
+    uint8_t type = static_cast<uint8_t>(major << 5);
+    if(value < 24)
+    {
+        head[0] = static_cast<uint8_t>(type | value);
+        return 1;
+    }
+    int bytes = value <= 0xff ? 1 : value <= 0xffff ? 2 : value <= 0xffffffffULL ? 4 : 8;
+    head[0] = static_cast<uint8_t>(type | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27));
+    for(int i = 0; i < bytes; i++)
+        head[1 + i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+    return static_cast<size_t>(1 + bytes);
+}
+
+static void put_head(arena_text *out, int major, uint64_t value)
+{
+    uint8_t head[9];
+    size_t n = encode_head(head, major, value);
+    arena_text_append(out, reinterpret_cast<const char *>(head), n);
+}
+
+void cbor_put_uint(arena_text *out, uint64_t value)
+{
+    put_head(out, CBOR_UINT, value);
+}
+
+void cbor_put_text(arena_text *out, const char *s, size_t length)
+{
+    put_head(out, CBOR_TEXT, length);
+    arena_text_append(out, s, length);
+}
+
+void cbor_put_bool(arena_text *out, bool value)
+{
+    put_head(out, CBOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void cbor_put_double(arena_text *out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t head[9];
+    head[0] = static_cast<uint8_t>(CBOR_SIMPLE << 5 | CBOR_DOUBLE); //always the 8 byte form, big endian like every other argument
+    for(int i = 0; i < 8; i++)
+        head[1 + i] = static_cast<uint8_t>(bits >> (8 * (7 - i)));
+    arena_text_append(out, reinterpret_cast<const char *>(head), sizeof(head));
+}
+
+void cbor_put_array(arena_text *out, size_t count)
+{
+    put_head(out, CBOR_ARRAY, count);
+}
+
+void cbor_put_map(arena_text *out, size_t count)
+{
+    put_head(out, CBOR_MAP, count);
+}
+
+std::string cbor_text(const char *s)
+{
+    uint8_t head[9];
+    size_t length = strlen(s);
+    size_t n = encode_head(head, CBOR_TEXT, length);
+    std::string encoded(reinterpret_cast<const char *>(head), n);
+    encoded.append(s, length);
+    return encoded;
+}
+
+/** a position in the input being decoded */
+typedef struct cbor_reader_s
+{
+    const uint8_t *p;
+    const uint8_t *end;
+} cbor_reader;
+
+/**
+ * Reads an item's head, rejecting indefinite lengths and reserved values.
+ */
+static bool read_head(cbor_reader *r, int *major, uint64_t *value)
+{
+    if(r->p == r->end)
+        return false;
+    uint8_t initial = *r->p++;
+    *major = initial >> 5;
+    uint8_t info = initial & 0x1f;
+    if(info < 24)
+    {
+        *value = info;
+        return true;
+    }
+    if(info > 27)
+        return false;
+    int bytes = 1 << (info - 24);
+    if(r->end - r->p < bytes)
+        return false;
+    *value = 0;
+    for(int i = 0; i < bytes; i++)
+        *value = *value << 8 | *r->p++;
+    return true;
+}
+
+static bool read_text(cbor_reader *r, std::string *text)
+{
+    int major;
+    uint64_t length;
+    if(!read_head(r, &major, &length) || major != CBOR_TEXT || length > static_cast<uint64_t>(r->end - r->p))
+        return false;
+    text->assign(reinterpret_cast<const char *>(r->p), static_cast<size_t>(length));
+    r->p += length;
+    return true;
+}
+
+/**
+ * Reads a text, integer or boolean value as text.
+ */
+static bool read_scalar(cbor_reader *r, std::string *value)
+{
+    if(r->p == r->end)
+        return false;
+    if(*r->p >> 5 == CBOR_TEXT)
+        return read_text(r, value);
+    int major;
+    uint64_t n;
+    if(!read_head(r, &major, &n))
+        return false;
+    char number[24];
+    switch(major)
+    {
+        case CBOR_UINT:
+            snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(n));
+            break;
+        case CBOR_NEGATIVE: //-1 - n
+            if(n == UINT64_MAX)
+                snprintf(number, sizeof(number), "-18446744073709551616");
+            else
+                snprintf(number, sizeof(number), "-%llu", static_cast<unsigned long long>(n) + 1);
+            break;
+        case CBOR_SIMPLE:
+            if(n != CBOR_FALSE && n != CBOR_TRUE)
+                return false;
+            snprintf(number, sizeof(number), "%s", n == CBOR_TRUE ? "true" : "false");
+            break;
+        default:
+            return false;
+    }
+    value->assign(number);
+    return true;
+}
+
+bool cbor_parse_text_map(const char *data, size_t length, std::vector<json_member> *members)
+{
+    cbor_reader r = { reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + length };
+    members->clear();
+    int major;
+    uint64_t count;
+    if(!read_head(&r, &major, &count) || major != CBOR_MAP || count > length)
+        return false;
+    for(uint64_t i = 0; i < count; i++)
+    {
+        json_member member;
+        if(!read_text(&r, &member.name) || !read_scalar(&r, &member.value))
+            return false;
+        members->push_back(member);
+    }
+    return r.p == r.end;
+}
@@ -0,0 +1,44 @@
+/**
+ *  /file guwhiteboardwebposter/cbor.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "json.h"
+
+/**
+ * The parts of CBOR (RFC 7049) the poster speaks: unsigned integers, text
+ * strings, booleans, doubles and definite length arrays and maps.
+ */
+
+void cbor_put_uint(arena_text *out, uint64_t value);
+void cbor_put_text(arena_text *out, const char *s, size_t length);
+void cbor_put_bool(arena_text *out, bool value);
+void cbor_put_double(arena_text *out, double value);
+void cbor_put_array(arena_text *out, size_t count);     ///< followed by 'count' items
+void cbor_put_map(arena_text *out, size_t count);       ///< followed by 'count' key, value pairs
+
+inline void cbor_put_text_str(arena_text *out, const char *s) { cbor_put_text(out, s, strlen(s)); }
+
+/** Encodes a text string into a std::string, for fragments built ahead of time. */
+std::string cbor_text(const char *s);
+
+/**
+ * Decodes a map of text keys such as {"Speech": "hello", "Print": "hi"}.
+ * Integer and boolean values are turned into their text.
+ */
+bool cbor_parse_text_map(const char *data, size_t length, std::vector<json_member> *members);
+
+#endif //CBOR_H
@@ -0,0 +1,146 @@
+/**
+ *  /file guwhiteboardwebposter/compress.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstring>
+
+#include <zlib.h>
+
+#include "compress.h"
+
+#define ZLIB_WINDOW_BITS 15
+#define ZLIB_MEM_LEVEL 8
+#define COMPRESS_CHUNK 16384        ///< output space reserved per deflate() call
+
+static int dynamic_level = Z_DEFAULT_COMPRESSION;
+
+/** a worker's deflate state for one coding, reset between responses */
+typedef struct compressor_s
+{
+    z_stream stream;
+    bool ready;
+} compressor;
+
+static thread_local compressor compressors[NUM_CONTENT_ENCODINGS];
+
+static int window_bits(enum Content_Encoding encoding)
+{
+    //'deflate' is the zlib format, gzip is asked for with the +16
+    return encoding == Encoding_Gzip ? ZLIB_WINDOW_BITS + 16 : ZLIB_WINDOW_BITS;
+}
+
+void compress_init(int level)
+{
+    dynamic_level = level;
+}
+
+bool compress_wanted(enum Content_Encoding encoding, size_t length)
+{
+    return dynamic_level > 0 && encoding != Encoding_Identity && length >= COMPRESS_MIN_SIZE;
+}
+
+enum Content_Encoding compress_negotiated(enum Content_Encoding encoding)
+{
+    return dynamic_level > 0 ? encoding : Encoding_Identity;
+}
+
+/** a deflate stream that lives as long as one streamed response */
+struct compress_stream_s
+{
+    z_stream stream;
+};
+
+/**
+ * Feeds data through the stream with the given flush mode, appending the output to 'out'.
+ */
+static bool deflate_into(z_stream *stream, const char *data, size_t length, int flush, arena_text *out)
+{
+    stream->next_in = data ? reinterpret_cast<Bytef *>(const_cast<char *>(data)) : Z_NULL;
+    stream->avail_in = static_cast<uInt>(length);
+    int r;
+    do
+    {
+        char *space = arena_text_reserve(out, COMPRESS_CHUNK);
+        stream->next_out = reinterpret_cast<Bytef *>(space);
+        stream->avail_out = COMPRESS_CHUNK;
+        r = deflate(stream, flush);
+        if(r == Z_STREAM_ERROR)
+            return false;
+        arena_text_commit(out, COMPRESS_CHUNK - stream->avail_out);
+    }
+    while(flush == Z_FINISH ? r != Z_STREAM_END : stream->avail_out == 0);
+    return true;
+}
+
+/**
+ * Feeds every part through the stream and finishes it, appending the output to 'out'.
+ */
+static bool deflate_parts(z_stream *stream, const body_part *parts, size_t count, arena_text *out)
+{
+    for(size_t i = 0; i < count; i++)
+        if(!deflate_into(stream, parts[i].data, parts[i].length, Z_NO_FLUSH, out))
+            return false;
+    return deflate_into(stream, nullptr, 0, Z_FINISH, out);
+}
+
+bool compress_parts(enum Content_Encoding encoding, const body_part *parts, size_t count, arena_text *out)
+{
+    compressor *c = &compressors[encoding];
+    if(!c->ready)
+    {
+        memset(&c->stream, 0, sizeof(c->stream));
+        if(deflateInit2(&c->stream, dynamic_level, Z_DEFLATED, window_bits(encoding), ZLIB_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        c->ready = true;
+    }
+    else if(deflateReset(&c->stream) != Z_OK)
+        return false;
+    return deflate_parts(&c->stream, parts, count, out);
+}
+
+compress_stream *compress_stream_begin(enum Content_Encoding encoding)
+{
+    compress_stream *s = new compress_stream();
+    memset(&s->stream, 0, sizeof(s->stream));
+    if(deflateInit2(&s->stream, dynamic_level, Z_DEFLATED, window_bits(encoding), ZLIB_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        delete s;
+        return nullptr;
+    }
+    return s;
+}
+
+bool compress_stream_write(compress_stream *s, const char *data, size_t length, bool finish, arena_text *out)
+{
+    //a sync flush ends every piece on a byte boundary, so the client can decode it straight away
+    return deflate_into(&s->stream, data, length, finish ? Z_FINISH : Z_SYNC_FLUSH, out);
+}
+
+void compress_stream_end(compress_stream *s)
+{
+    if(!s)
+        return;
+    deflateEnd(&s->stream);
+    delete s;
+}
+
+bool compress_buffer(enum Content_Encoding encoding, int level, const char *data, size_t length, std::string *out)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if(deflateInit2(&stream, level, Z_DEFLATED, window_bits(encoding), ZLIB_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    out->resize(deflateBound(&stream, static_cast<uLong>(length)));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(length);
+    stream.next_out = reinterpret_cast<Bytef *>(&(*out)[0]);
+    stream.avail_out = static_cast<uInt>(out->size());
+    int r = deflate(&stream, Z_FINISH);
+    out->resize(stream.total_out);
+    deflateEnd(&stream);
+    return r == Z_STREAM_END;
+}
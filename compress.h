@@ -0,0 +1,63 @@
+/**
+ *  /file guwhiteboardwebposter/compress.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <cstddef>
+#include <string>
+
+#include "arena.h"
+#include "guwhiteboardwebposter.h"
+
+#define COMPRESS_MIN_SIZE 1024      ///< smaller bodies aren't worth the CPU or the header bytes
+#define COMPRESS_STATIC_LEVEL 9     ///< static assets are only compressed once, so use the best level
+
+/** Sets the level dynamic responses are compressed at, 0 turns it off. Call before any worker starts. */
+void compress_init(int level);
+
+/** Whether a response body of this length should be compressed for the client. */
+bool compress_wanted(enum Content_Encoding encoding, size_t length);
+
+/**
+ * The coding a compressible response to a client taking 'encoding' is
+ * sent with once its body is big enough, for entity tags that have to be
+ * made before the body is.
+ */
+enum Content_Encoding compress_negotiated(enum Content_Encoding encoding);
+
+/**
+ * Compresses the parts as one stream into 'out'.  Each worker thread keeps
+ * its zlib state between responses, so this doesn't allocate once warm.
+ * Returns false if zlib failed, in which case send the body as it is.
+ */
+bool compress_parts(enum Content_Encoding encoding, const body_part *parts, size_t count, arena_text *out);
+
+/** deflate state for a body that is compressed a piece at a time */
+typedef struct compress_stream_s compress_stream;
+
+/**
+ * Starts compressing a streamed body, nullptr if zlib couldn't.  Unlike
+ * compress_parts() the state belongs to the response, since other
+ * responses are sent while it is part way through.
+ */
+compress_stream *compress_stream_begin(enum Content_Encoding encoding);
+
+/**
+ * Compresses the next piece of the body into 'out', flushed so the
+ * client can decode everything sent so far.  'finish' ends the stream.
+ */
+bool compress_stream_write(compress_stream *s, const char *data, size_t length, bool finish, arena_text *out);
+
+/** Releases the state, nullptr is ignored. */
+void compress_stream_end(compress_stream *s);
+
+/** One off compression at the given level, for content that is compressed ahead of time. */
+bool compress_buffer(enum Content_Encoding encoding, int level, const char *data, size_t length, std::string *out);
+
+#endif //COMPRESS_H
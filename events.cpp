@@ -0,0 +1,123 @@
+/**
+ *  /file guwhiteboardwebposter/events.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "gusimplewhiteboard.h"
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "events.h"
+#include "metrics.h"
+#include "server.h"
+#include "wb_types.h"
+
+static void subscribe(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, int type)
+{
+    if(!wb_type(type)->parsable)
+        return; //there'd never be anything to send
+    for(size_t i = 0; i < conn->stream_types.size(); i++)
+        if(conn->stream_types[i] == type)
+            return;
+    conn->stream_types.push_back(type);
+    //one behind the current count, so the first update sends the current value
+    conn->stream_counters.push_back(static_cast<uint16_t>(wb_type_event_counter(wbd, type) - 1));
+}
+
+void handle_event_stream(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header)
+{
+    conn->stream_types.clear();
+    conn->stream_counters.clear();
+
+    http_string types;
+    if(http_query_param(header->url, "types", &types) && types.length > 0)
+    {
+        int found[GSW_NUM_TYPES_DEFINED];
+        size_t count = wb_find_types(types, found, GSW_NUM_TYPES_DEFINED);
+        for(size_t i = 0; i < count; i++)
+            subscribe(conn, wbd, found[i]);
+    }
+    else
+    {
+        for(int i = 1; i < GSW_NUM_TYPES_DEFINED; i++)
+            subscribe(conn, wbd, i);
+    }
+
+    enum HTTP_Version version = header->version < NUM_HTTP_VERSIONS ? header->version : HTTP_V1_1;
+    write_queue_append_str(&conn->out, HTTP_Version_Strings[version]);
+    write_queue_append_str(&conn->out, " ");
+    write_queue_append_str(&conn->out, HTTP_Code_Strings[_200_OK]);
+    write_queue_append_str(&conn->out, "\r\n"
+                     "Content-Type: text/event-stream;charset=UTF-8\r\n"
+                     "Cache-Control: no-cache\r\n"
+                     "Connection: keep-alive\r\n"
+                     "\r\n"
+                     "retry: 1000\n\n");
+    conn->code = _200_OK; //the head is written here rather than by generate_response_head()
+    conn->state = CONN_STREAMING;
+}
+
+/**
+ * Appends one event, one 'data:' line per line of the value as the
+ * event-stream format requires.
+ */
+static void append_event(write_queue *out, const char *type, const std::string &value)
+{
+    write_queue_append_str(out, "event: ");
+    write_queue_append_str(out, type);
+    write_queue_append_str(out, "\n");
+    size_t start = 0;
+    do
+    {
+        size_t end = value.find_first_of("\r\n", start);
+        if(end == std::string::npos)
+            end = value.length();
+        write_queue_append_str(out, "data: ");
+        write_queue_append(out, value.data() + start, end - start);
+        write_queue_append_str(out, "\n");
+        if(end < value.length() && value[end] == '\r' && end + 1 < value.length() && value[end + 1] == '\n')
+            end++;
+        start = end + 1;
+    }
+    while(start <= value.length());
+    write_queue_append_str(out, "\n");
+}
+
+void event_stream_update(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, event_stream_cache *cache)
+{
+    if(cache->values.size() != GSW_NUM_TYPES_DEFINED)
+    {
+        cache->values.resize(GSW_NUM_TYPES_DEFINED);
+        cache->counters.resize(GSW_NUM_TYPES_DEFINED);
+        cache->valid.resize(GSW_NUM_TYPES_DEFINED, false);
+    }
+
+    for(size_t i = 0; i < conn->stream_types.size(); i++)
+    {
+        int type = conn->stream_types[i];
+        uint16_t counter = wb_type_event_counter(wbd, type);
+        if(counter == conn->stream_counters[i])
+            continue;
+        conn->stream_counters[i] = counter;
+
+        size_t t = static_cast<size_t>(type);
+        if(!cache->valid[t] || cache->counters[t] != counter)
+        {
+            //the counter is read first, so a post racing with this is picked up next time
+            uint64_t start = monotonic_ns();
+            char *value = whiteboard_getmsg_from(wbd, type);
+            metrics_whiteboard(start);
+            cache->values[t] = value;
+            free(value);
+            cache->counters[t] = counter;
+            cache->valid[t] = true;
+        }
+        append_event(&conn->out, WBTypes_stringValues[type], cache->values[t]);
+    }
+}
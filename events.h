@@ -0,0 +1,45 @@
+/**
+ *  /file guwhiteboardwebposter/events.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "guwhiteboardwebposter.h"
+
+#define EVENT_STREAM_INTERVAL_MS 100            ///< how often subscribed types are checked for changes
+#define EVENT_STREAM_MAX_BACKLOG (256 * 1024)   ///< unsent or held output before a slow subscriber is dropped
+
+/**
+ * The last serialised value of each type, shared by all of a worker's event
+ * streams so a change is only fetched from the whiteboard once.
+ */
+typedef struct event_stream_cache_s
+{
+    std::vector<std::string> values;
+    std::vector<uint16_t> counters;     ///< event counter 'values' was read at
+    std::vector<bool> valid;
+} event_stream_cache;
+
+/**
+ * GET /events?types=A,B,... switches the connection to a 'text/event-stream'
+ * response.  Without 'types' every message type is subscribed to.
+ */
+void handle_event_stream(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header);
+
+/**
+ * Queues an event on the connection for every subscribed type whose event
+ * counter has moved since it was last sent.
+ */
+void event_stream_update(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, event_stream_cache *cache);
+
+#endif //EVENTS_H
@@ -0,0 +1,94 @@
+/**
+ *  /file guwhiteboardwebposter/guwhiteboardwebposter.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef GUWHITEBOARDWEBPOSTER_H
+#define GUWHITEBOARDWEBPOSTER_H
+
+#include <string>
+
+#include <sys/time.h>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wreserved-id-macro"
+#pragma clang diagnostic ignored "-Wunused-macros"
+
+#undef __block
+#define __block _xblock
+#include <unistd.h> //optargs
+#undef __block
+#define __block __attribute__((__blocks__(byref)))
+
+#pragma clang diagnostic pop
+
+#include "gusimplewhiteboard.h"
+
+#include "http_parser.h"
+
+#define DEFAULT_PORT 4242
+#define DEFAULT_IDLE_TIMEOUT 5  ///< seconds
+#define DEFAULT_THREADS 1
+#define DEFAULT_COMPRESSION_LEVEL 6 ///< zlib level for dynamic responses, 0 to turn compression off
+#define DEFAULT_MAX_BODY_SIZE (1024 * 1024) ///< bytes, larger request bodies are answered with 413
+#define DEFAULT_POST_RATE 0     ///< post queue flushes a second, 0 posts while the request is handled
+#define DEFAULT_HISTORY_SIZE 256 ///< KB of history kept for each recorded type
+
+/** command line configuration for the server */
+typedef struct server_options_s
+{
+    const char *wbname;         ///< whiteboard to interact with
+    int port;                   ///< web server port
+    int idle_timeout;           ///< seconds before an idle or stalled connection is closed
+    int threads;                ///< number of worker threads, each with its own event loop
+    int compression_level;      ///< zlib level for dynamic responses, 0 for none
+    size_t max_body_size;       ///< largest request body accepted, after any chunked decoding
+    int post_rate;              ///< post queue flushes a second, 0 for no queue
+    const char *history_types;  ///< comma separated types to record the history of, "all" for every parsable one, nullptr for none
+    size_t history_size;        ///< bytes of history kept for each recorded type
+    const char *record_path;    ///< file to record whiteboard traffic to, nullptr for none
+    const char *record_types;   ///< comma separated types to record, "all" for every parsable one
+    const char *replay_path;    ///< recording to offer for replay at /replay, nullptr for none
+} server_options;
+
+/** socket variables */
+typedef struct socket_s
+{
+    int                 socket;         ///< socket file descriptor
+    void *data;         //recv buffer poitner
+    size_t data_size;   ///< size of the data
+} socket_descriptor;
+
+struct connection_s;
+
+/** a piece of a response body */
+typedef struct body_part_s
+{
+    const char *data;
+    size_t length;
+    bool borrowed;      ///< outlives the connection, so it's written from where it is instead of copied
+} body_part;
+
+//server
+bool serverd(const server_options *options); ///< false if it couldn't start, or a worker didn't
+socket_descriptor *init_socket(int port, bool reuseport);
+void close_socket(socket_descriptor *sd);
+
+//request handling
+void handle_request(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+void handle_html(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+void handle_json(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+void handle_get_request_json(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header);
+void handle_post_patch_request_json(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+void handle_cbor(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+void handle_get_request_cbor(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header);
+void handle_post_patch_request_cbor(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+void handle_get_request_html(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header);
+void generate_response(struct connection_s *conn, enum HTTP_Version version, enum HTTP_Code code, enum Content_Type type, const std::string &body, const char *headers = nullptr);
+void generate_response_head(struct connection_s *conn, enum HTTP_Version version, enum HTTP_Code code, const char *content_type, const char *framing, enum Content_Encoding encoding, bool compressible, const char *headers);
+void generate_response_parts(struct connection_s *conn, enum HTTP_Version version, enum HTTP_Code code, const char *content_type, const body_part *parts, size_t count, const char *headers = nullptr, bool compressible = true);
+
+#endif //GUWHITEBOARDWEBPOSTER_H
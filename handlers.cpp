@@ -0,0 +1,832 @@
+/**
+ *  /file guwhiteboardwebposter/handlers.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "gu_util.h"
+#include "gusimplewhiteboard.h"
+#include "gugenericwhiteboardobject.h"
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "guwhiteboardwebposter.h"
+#include "assets.h"
+#include "cbor.h"
+#include "compress.h"
+#include "events.h"
+#include "history.h"
+#include "json.h"
+#include "metrics.h"
+#include "percent.h"
+#include "post_queue.h"
+#include "raw.h"
+#include "replay.h"
+#include "response_stream.h"
+#include "snapshot.h"
+#include "server.h"
+#include "wb_types.h"
+
+/**
+ * Whether the request is for the root listing, '/' or an empty target.
+ */
+static bool url_is_root(const struct header_info_s *header)
+{
+    return header->url.length == 0 || http_string_equals(header->url, "/");
+}
+
+/**
+ * Type named by a '/$(msg)' URL, or -1 if it doesn't name one.
+ * 'name' is set to the path after the leading '/', a view into the request.
+ */
+static int url_message_type(const struct header_info_s *header, http_string *name)
+{
+    http_string path = http_url_path(header->url);
+    if(path.length < 2 || path.data[0] != '/')
+    {
+        name->data = path.data;
+        name->length = 0;
+        return -1;
+    }
+    name->data = path.data + 1;
+    name->length = path.length - 1;
+    return wb_find_type(name->data, name->length);
+}
+
+#define ETAG_HEADERS_SIZE (WB_ETAG_SIZE + 48)
+
+/**
+ * Response header lines that go with an entity tag, empty if there isn't one.
+ * Clients must revalidate, since any post can change the value.
+ */
+static const char *etag_headers(const char *etag, char *headers)
+{
+    headers[0] = '\0';
+    if(etag[0] != '\0')
+        snprintf(headers, ETAG_HEADERS_SIZE, "ETag: %s\r\nCache-Control: no-cache\r\n", etag);
+    return headers;
+}
+
+/** Sends an arena built body. */
+static void generate_text_response(struct connection_s *conn, struct header_info_s *header, enum HTTP_Code code, const arena_text *body, const char *headers)
+{
+    body_part part = { body->data, body->length, false };
+    generate_response_parts(conn, header->version, code, Content_Type_Strings[header->accept], &part, 1, headers);
+}
+
+/**
+ * Answers '304 Not Modified' if the client's 'If-None-Match' already has etag.
+ * Returns true if it did.
+ */
+static bool not_modified(struct connection_s *conn, struct header_info_s *header, const char *etag)
+{
+    const http_string *if_none_match = http_find_field(&header->request, "If-None-Match");
+    if(if_none_match == nullptr || !http_etag_matches(*if_none_match, etag))
+        return false;
+    char headers[ETAG_HEADERS_SIZE];
+    generate_response_parts(conn, header->version, _304_Not_Modified, Content_Type_Strings[header->accept], nullptr, 0, etag_headers(etag, headers));
+    return true;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+void handle_html(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+#pragma clang diagnostic push
+{
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wswitch-enum"
+    switch(header->verb)
+    {
+        case HTTP_GET:
+        {
+            handle_get_request_html(conn, wbd, header);
+            break;
+        }
+        case HTTP_POST:
+        {
+            break;
+        }
+        case HTTP_PUT:
+        {
+            break;
+        }
+        case HTTP_DELETE:
+        {
+            break;
+        }
+        case HTTP_PATCH:
+        {
+            break;
+        }
+        default:
+            break;
+    }
+#pragma clang diagnostic pop
+}
+   
+void handle_json(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wswitch-enum"
+    switch(header->verb)
+    {
+        case HTTP_GET:
+        {
+            handle_get_request_json(conn, wbd, header);
+            break;
+        }
+        case HTTP_PATCH:
+        case HTTP_POST:
+        {
+            handle_post_patch_request_json(conn, wbd, header, body);
+            break;
+        }
+        case HTTP_PUT:
+        {
+            break;
+        }
+        case HTTP_DELETE:
+        {
+            break;
+        }
+        default:
+            break;
+    }
+#pragma clang diagnostic pop
+}
+
+void handle_request(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+    if(http_string_equals(header->url, "/favicon.ico"))
+    {
+        fprintf(stderr, "Ignoring 'favicon.ico' request\n");
+        generate_response(conn, HTTP_V1_1, _404_Not_Found, Text_HTML, "");
+        return;
+    }
+    const static_asset *asset = header->verb == HTTP_GET ? find_asset(http_url_path(header->url)) : nullptr;
+    if(asset)
+    {
+        conn->route = ROUTE_ASSET;
+        handle_asset(conn, header, asset);
+        return;
+    }
+    if(header->verb == HTTP_GET && http_string_equals(http_url_path(header->url), "/events"))
+    {
+        conn->route = ROUTE_EVENTS;
+        handle_event_stream(conn, wbd, header);
+        return;
+    }
+    if(http_url_path(header->url).length > 5 && memcmp(header->url.data, "/raw/", 5) == 0)
+    {
+        conn->route = ROUTE_RAW;
+        handle_raw(conn, wbd, header, body);
+        return;
+    }
+    if(header->verb == HTTP_GET && http_url_path(header->url).length > 9 && memcmp(header->url.data, "/history/", 9) == 0)
+    {
+        conn->route = ROUTE_HISTORY;
+        handle_history(conn, header);
+        return;
+    }
+    if(http_string_equals(http_url_path(header->url), "/replay"))
+    {
+        conn->route = ROUTE_REPLAY;
+        handle_replay(conn, header, body);
+        return;
+    }
+    if(header->verb == HTTP_GET && http_string_equals(http_url_path(header->url), "/snapshot"))
+    {
+        conn->route = ROUTE_SNAPSHOT;
+        handle_snapshot(conn, wbd, header);
+        return;
+    }
+    if(header->verb == HTTP_GET && http_string_equals(http_url_path(header->url), "/metrics"))
+    {
+        conn->route = ROUTE_METRICS;
+        handle_metrics(conn, header);
+        return;
+    }
+
+    conn->route = url_is_root(header) ? ROUTE_ROOT : ROUTE_MESSAGE;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wswitch-enum"
+    switch(header->accept)
+    {
+        case Text_HTML:
+        {
+            handle_html(conn, wbd, header, body);
+            break;
+        }
+        case Application_vnd_api_json:
+        case Application_json:
+        {
+            handle_json(conn, wbd, header, body);
+            break;
+        }
+        case Application_cbor:
+        {
+            handle_cbor(conn, wbd, header, body);
+            break;
+        }
+        case WildCard: //Accept: */*, give them JSON
+        {
+            handle_json(conn, wbd, header, body);
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+#pragma clang diagnostic pop
+}
+
+void generate_response(struct connection_s *conn, enum HTTP_Version version, enum HTTP_Code code, enum Content_Type type, const std::string &body, const char *headers)
+{
+    body_part part = { body.data(), body.length(), false };
+    generate_response_parts(conn, version, code, Content_Type_Strings[type], &part, 1, headers);
+}
+
+void generate_response_parts(struct connection_s *conn, enum HTTP_Version version, enum HTTP_Code code, const char *content_type, const body_part *parts, size_t count, const char *headers, bool compressible)
+{
+    if(version >= NUM_HTTP_VERSIONS)
+        version = HTTP_V1_1;
+    size_t length = 0;
+    for(size_t i = 0; i < count; i++)
+        length += parts[i].length;
+
+    //compressed into the arena and sent as a single part
+    enum Content_Encoding encoding = conn->header_info.accept_encoding;
+    bool vary = compressible && (code == _200_OK || code == _304_Not_Modified); //a 304 stands in for the 200
+    compressible = compressible && code == _200_OK;
+    body_part compressed;
+    if(compressible && compress_wanted(encoding, length))
+    {
+        uint64_t start = monotonic_ns();
+        arena_text text;
+        arena_text_init(&text, &conn->scratch);
+        if(compress_parts(encoding, parts, count, &text))
+        {
+            request_metrics *metrics = metrics_local();
+            metrics_add(&metrics->compressed_responses, 1);
+            metrics_add(&metrics->compressed_bytes_in, length);
+            metrics_add(&metrics->compressed_bytes_out, text.length);
+            metrics_add(&metrics->compression_ns, monotonic_ns() - start);
+            compressed.data = text.data;
+            compressed.length = text.length;
+            compressed.borrowed = false;
+            parts = &compressed;
+            count = 1;
+            length = text.length;
+        }
+        else
+            encoding = Encoding_Identity;
+    }
+    else
+        encoding = Encoding_Identity;
+
+    char content_length[48];
+    content_length[0] = '\0';
+    if(code != _204_No_Content && code != _304_Not_Modified) //can't have a body
+        snprintf(content_length, sizeof(content_length), "Content-Length: %zu\r\n", length);
+    else
+        count = 0;
+    generate_response_head(conn, version, code, content_type, content_length, encoding, vary, headers);
+
+    write_queue *out = &conn->out;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(parts[i].borrowed)
+            write_queue_append_borrowed(out, parts[i].data, parts[i].length);
+        else
+            write_queue_append(out, parts[i].data, parts[i].length);
+    }
+    conn->state = CONN_WRITING; //the event loop drains 'out' before reading the next request
+}
+
+void generate_response_head(struct connection_s *conn, enum HTTP_Version version, enum HTTP_Code code, const char *content_type, const char *framing, enum Content_Encoding encoding, bool compressible, const char *headers)
+{
+    //straight into the write queue, which keeps its storage between responses
+    conn->code = code;
+    write_queue *out = &conn->out;
+    write_queue_append_str(out, HTTP_Version_Strings[version]);
+    write_queue_append_str(out, " ");
+    write_queue_append_str(out, HTTP_Code_Strings[code]);
+    write_queue_append_str(out, "\r\n");
+    write_queue_append_str(out, "Content-Type: ");
+    write_queue_append_str(out, content_type);
+    if(content_type != Content_Type_Strings[Application_cbor] && content_type != Content_Type_Strings[Application_octet_stream]) //binary types don't have a charset
+    {
+        write_queue_append_str(out, ";");
+        write_queue_append_str(out, "charset=UTF-8");
+    }
+    write_queue_append_str(out, "\r\n");
+    write_queue_append_str(out, framing);
+    if(encoding != Encoding_Identity)
+    {
+        write_queue_append_str(out, "Content-Encoding: ");
+        write_queue_append_str(out, Content_Encoding_Strings[encoding]);
+        write_queue_append_str(out, "\r\n");
+    }
+    if(compressible)
+        write_queue_append_str(out, "Vary: Accept-Encoding\r\n");
+    if(headers)
+        write_queue_append_str(out, headers);
+    write_queue_append_str(out, "Connection: ");
+    write_queue_append_str(out, conn->keep_alive ? "keep-alive" : "close");
+    write_queue_append_str(out, "\r\n");
+    write_queue_append_str(out, "\r\n");
+}
+
+/**
+ * Row 'row' of the GET / JSON listing, {"types":[{"type":name, "parsable":bool}, ...]},
+ * produced as it is sent.
+ */
+static bool json_listing_row(gu_simple_whiteboard_descriptor *, int row, arena_text *out)
+{
+    if(row == 0)
+        arena_text_append_str(out, "{\"types\":[\r\n");
+    else if(row <= GSW_NUM_TYPES_DEFINED)
+    {
+        int i = row - 1;
+        const wb_type_info *info = wb_type(i);
+        arena_text_append_str(out, "\t{\"type\":");
+        arena_text_append(out, info->json_name.data(), info->json_name.length());
+        arena_text_append_str(out, ", \"parsable\":");
+        arena_text_append_str(out, info->parsable ? "true" : "false");
+        arena_text_append_str(out, "}");
+        if(i != GSW_NUM_TYPES_DEFINED - 1)
+            arena_text_append_str(out, ",");
+        arena_text_append_str(out, "\r\n");
+    }
+    else if(row == GSW_NUM_TYPES_DEFINED + 1)
+        arena_text_append_str(out, "]}\r\n");
+    else
+        return false;
+    return true;
+}
+
+void handle_get_request_json(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header)
+{
+    arena_text response;
+    arena_text_init(&response, &conn->scratch);
+    char etag[WB_ETAG_SIZE];
+    etag[0] = '\0';
+
+    if(url_is_root(header))
+    {   //URL == /           - all messages, array
+        wb_type_list_etag(header->accept, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+        if(not_modified(conn, header, etag))
+            return;
+        char headers[ETAG_HEADERS_SIZE];
+        response_stream_begin(conn, wbd, header->version, Content_Type_Strings[header->accept], etag_headers(etag, headers), json_listing_row);
+        return;
+    } 
+    else 
+    {   //URL == /$(msg) 
+        http_string msg_name;
+        int type = url_message_type(header, &msg_name);
+        if(msg_name.length == 0)
+        {
+            generate_text_response(conn, header, _404_Not_Found, &response, nullptr);
+            return;
+        }
+        if(type != -1)
+        {
+            wb_type_etag(wbd, type, header->accept, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+            if(not_modified(conn, header, etag))
+                return; //without calling the getter
+        }
+        arena_text_append_str(&response, "{\"value\":");
+        if(type != -1)
+            wb_type_value_json(wbd, type, &response);
+        else
+            arena_text_append_str(&response, "\"##unsupported##\"");
+        arena_text_append_str(&response, "}");
+    } 
+    char headers[ETAG_HEADERS_SIZE];
+    generate_text_response(conn, header, _200_OK, &response, etag_headers(etag, headers));
+}
+
+/**
+ * Posts one entry of a batch, returning its status: 200 posted, 202 queued
+ * (with its sequence number), 404 no such type, 422 the type's parser
+ * rejected it (or it has none).
+ */
+static int post_member(gu_simple_whiteboard_descriptor *wbd, const json_member *member, uint64_t *sequence)
+{
+    int type = wb_find_type(member->name.data(), member->name.length());
+    if(type == -1)
+        return 404;
+    if(post_queue_enabled())
+    {   //a type without a parser could only be dropped by the flush thread
+        if(!wb_type(type)->parsable)
+            return 422;
+        *sequence = post_queue_push(type, member->value);
+        return 202;
+    }
+    return wb_post(wbd, type, member->value) ? 200 : 422;
+}
+
+/** The body of a 202 for a queued post, {"sequence":N}. */
+static std::string sequence_json(uint64_t sequence)
+{
+    return "{\"sequence\":" + std::to_string(sequence) + "}";
+}
+
+/**
+ * Posts every member of a {"Speech":"hello","Print":"hi"} body in document
+ * order and answers a status for each.
+ */
+static void handle_batch_post(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+    std::vector<json_member> members;
+    if(!json_parse_object(body, strlen(body), &members))
+    {
+        generate_response(conn, header->version, _400_Bad_Request, header->accept, "");
+        return;
+    }
+
+    std::string response;
+    response.append("{\"results\":[\r\n");
+    for(size_t i = 0; i < members.size(); i++)
+    {
+        uint64_t sequence = 0;
+        int status = post_member(wbd, &members[i], &sequence);
+        if(i > 0)
+            response.append(",\r\n");
+        response.append("\t{\"type\":");
+        json_append_string(&response, members[i].name.c_str());
+        response.append(", \"status\":");
+        response.append(std::to_string(status));
+        if(status == 202)
+        {
+            response.append(", \"sequence\":");
+            response.append(std::to_string(sequence));
+        }
+        response.append("}");
+    }
+    response.append("\r\n]}");
+    generate_response(conn, header->version, _200_OK, header->accept, response);
+}
+
+/**
+ * Reads the message value out of a {"value":"..."} body, any other members
+ * are skipped whatever they hold.  A number or literal is taken as its text.
+ */
+static bool read_value_member(const char *body, size_t length, std::string *value)
+{
+    json_reader reader;
+    json_reader_init(&reader, body, length);
+    if(json_reader_next(&reader) != JSON_OBJECT_BEGIN)
+        return false;
+    bool found = false;
+    enum JSON_Token token;
+    while((token = json_reader_next(&reader)) == JSON_NAME)
+    {
+        bool is_value = reader.text == "value";
+        token = json_reader_next(&reader);
+        if(is_value)
+        {
+            if(token != JSON_STRING && token != JSON_LITERAL)
+                return false;
+            value->swap(reader.text);
+            found = true;
+        }
+        else if(!json_reader_skip(&reader, token))
+            return false;
+    }
+    return found && token == JSON_OBJECT_END && json_reader_next(&reader) == JSON_END;
+}
+
+void handle_post_patch_request_json(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+    std::string response;
+
+    if(url_is_root(header))
+    {   //URL == /           - {"type":"value", ...} batch
+        handle_batch_post(conn, wbd, header, body);
+        return;
+    } 
+    else 
+    {   //URL == /$(msg) 
+        std::string value;
+        if(!read_value_member(body, strlen(body), &value))
+        {
+            generate_response(conn, header->version, _400_Bad_Request, header->accept, response);
+            return;
+        }
+        //the page percent encodes what it posts, decoding can only shorten it
+        char *value_decoded = static_cast<char *>(arena_alloc(&conn->scratch, value.length() + 1));
+        if(percent_decode(value.data(), value.length(), value_decoded, value.length() + 1) < 0)
+        {
+            generate_response(conn, header->version, _400_Bad_Request, header->accept, response);
+            return;
+        }
+
+        http_string msg_name;
+        int type = url_message_type(header, &msg_name);
+        if(msg_name.length == 0)
+        {
+            generate_response(conn, header->version, _404_Not_Found, header->accept, response);
+            return;
+        }
+
+        if(type != -1 && post_queue_enabled() && wb_type(type)->parsable)
+        {   //acknowledged now, posted by the flush thread
+            generate_response(conn, header->version, _202_Accepted, header->accept, sequence_json(post_queue_push(type, value_decoded)));
+            return;
+        }
+        bool exists = type != -1 && wb_post(wbd, type, value_decoded);
+        if(!exists)
+        {
+            generate_response(conn, header->version, _400_Bad_Request, header->accept, response);
+            return;
+        }
+        handle_get_request_json(conn, wbd, header);
+    } 
+}
+
+/** Length of the request body, which may contain NULs. */
+static size_t body_length(const struct header_info_s *header)
+{
+    return header->content_length > 0 ? static_cast<size_t>(header->content_length) : 0;
+}
+
+void handle_cbor(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wswitch-enum"
+    switch(header->verb)
+    {
+        case HTTP_GET:
+        {
+            handle_get_request_cbor(conn, wbd, header);
+            break;
+        }
+        case HTTP_PATCH:
+        case HTTP_POST:
+        {
+            handle_post_patch_request_cbor(conn, wbd, header, body);
+            break;
+        }
+        default:
+            break;
+    }
+#pragma clang diagnostic pop
+}
+
+void handle_get_request_cbor(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header)
+{
+    arena_text response;
+    arena_text_init(&response, &conn->scratch);
+    char etag[WB_ETAG_SIZE];
+    etag[0] = '\0';
+
+    if(url_is_root(header))
+    {   //URL == /           - {"types": [{"type": name, "parsable": bool}, ...]}
+        wb_type_list_etag(header->accept, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+        if(not_modified(conn, header, etag))
+            return;
+        cbor_put_map(&response, 1);
+        cbor_put_text_str(&response, "types");
+        cbor_put_array(&response, GSW_NUM_TYPES_DEFINED);
+        for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+        {
+            const wb_type_info *info = wb_type(i);
+            cbor_put_map(&response, 2);
+            cbor_put_text_str(&response, "type");
+            arena_text_append(&response, info->cbor_name.data(), info->cbor_name.length());
+            cbor_put_text_str(&response, "parsable");
+            cbor_put_bool(&response, info->parsable);
+        }
+    }
+    else
+    {   //URL == /$(msg)     - {"value": text}
+        http_string msg_name;
+        int type = url_message_type(header, &msg_name);
+        if(type == -1)
+        {
+            generate_text_response(conn, header, _404_Not_Found, &response, nullptr);
+            return;
+        }
+        wb_type_etag(wbd, type, header->accept, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+        if(not_modified(conn, header, etag))
+            return;
+        arena_text value;
+        arena_text_init(&value, &conn->scratch);
+        wb_type_value(wbd, type, &value);
+        cbor_put_map(&response, 1);
+        cbor_put_text_str(&response, "value");
+        cbor_put_text(&response, value.data, value.length);
+    }
+    char headers[ETAG_HEADERS_SIZE];
+    generate_text_response(conn, header, _200_OK, &response, etag_headers(etag, headers));
+}
+
+void handle_post_patch_request_cbor(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+    arena_text response;
+    arena_text_init(&response, &conn->scratch);
+    if(header->content_type != Application_cbor)
+    {
+        generate_text_response(conn, header, _415_Unsupported_Media_Type, &response, nullptr);
+        return;
+    }
+    std::vector<json_member> members;
+    if(!cbor_parse_text_map(body, body_length(header), &members))
+    {
+        generate_text_response(conn, header, _400_Bad_Request, &response, nullptr);
+        return;
+    }
+
+    if(url_is_root(header))
+    {   //URL == /           - {"type": "value", ...} batch, answered with {"results": [{"type": name, "status": code}, ...]}
+        cbor_put_map(&response, 1);
+        cbor_put_text_str(&response, "results");
+        cbor_put_array(&response, members.size());
+        for(size_t i = 0; i < members.size(); i++)
+        {
+            uint64_t sequence = 0;
+            int status = post_member(wbd, &members[i], &sequence);
+            cbor_put_map(&response, status == 202 ? 3 : 2);
+            cbor_put_text_str(&response, "type");
+            cbor_put_text(&response, members[i].name.data(), members[i].name.length());
+            cbor_put_text_str(&response, "status");
+            cbor_put_uint(&response, static_cast<uint64_t>(status));
+            if(status == 202)
+            {
+                cbor_put_text_str(&response, "sequence");
+                cbor_put_uint(&response, sequence);
+            }
+        }
+        generate_text_response(conn, header, _200_OK, &response, nullptr);
+        return;
+    }
+
+    //URL == /$(msg)         - {"value": "..."}
+    if(members.size() != 1 || members[0].name != "value")
+    {
+        generate_text_response(conn, header, _400_Bad_Request, &response, nullptr);
+        return;
+    }
+    http_string msg_name;
+    int type = url_message_type(header, &msg_name);
+    if(type == -1)
+    {
+        generate_text_response(conn, header, _404_Not_Found, &response, nullptr);
+        return;
+    }
+    if(post_queue_enabled() && wb_type(type)->parsable)
+    {   //{"sequence": N}, posted by the flush thread
+        cbor_put_map(&response, 1);
+        cbor_put_text_str(&response, "sequence");
+        cbor_put_uint(&response, post_queue_push(type, members[0].value));
+        generate_text_response(conn, header, _202_Accepted, &response, nullptr);
+        return;
+    }
+    if(!wb_post(wbd, type, members[0].value))
+    {
+        generate_text_response(conn, header, _400_Bad_Request, &response, nullptr);
+        return;
+    }
+    handle_get_request_cbor(conn, wbd, header);
+}
+
+/**
+ * Row 'row' of the GET / HTML page: the page head and table header, then
+ * one row per type with its current value, then the page tail.  Values are
+ * fetched as their rows are produced, so the first of the page is sent
+ * before the last value has been read.
+ */
+static bool html_listing_row(gu_simple_whiteboard_descriptor *wbd, int row, arena_text *out)
+{
+    if(row == 0)
+    {
+        const std::string &head = html_page_head();
+        arena_text_append(out, head.data(), head.length());
+        arena_text_append_str(out, "<h1>Whiteboard Types</h1>\r\n");
+        arena_text_append_str(out, "<table>\r\n");
+
+        arena_text_append_str(out, "<tr>\r\n");
+        arena_text_append_str(out, "<td>\r\n");
+        arena_text_append_str(out, "<input type=\"checkbox\" onClick=\"toggleAll(this)\" />");
+        arena_text_append_str(out, "</td>\r\n");
+        arena_text_append_str(out, "<td>\r\n");
+        arena_text_append_str(out, "Toggle All");
+        arena_text_append_str(out, "</td>\r\n");
+        arena_text_append_str(out, "</tr>\r\n");
+    }
+    else if(row <= GSW_NUM_TYPES_DEFINED)
+    {
+        int i = row - 1;
+        const wb_type_info *info = wb_type(i);
+        arena_text_append_str(out, "<tr>\r\n");
+        arena_text_append_str(out, "<td>\r\n");
+        arena_text_append_str(out, "<input type='checkbox' id='chk_");
+        arena_text_append(out, info->html_name.data(), info->html_name.length());
+        arena_text_append_str(out, "' name='wbmonitor' onclick='handleClick(this);'>");
+        arena_text_append_str(out, "</td>\r\n");
+        arena_text_append_str(out, "<td>\r\n");
+        if(info->parsable)
+        {
+            arena_text_append_str(out, "<a href=\"/");
+            arena_text_append(out, info->html_name.data(), info->html_name.length());
+            arena_text_append_str(out, "\">");
+            arena_text_append(out, info->html_name.data(), info->html_name.length());
+            arena_text_append_str(out, "</a>\r\n");
+
+            arena_text_append_str(out, "<td id='");
+            arena_text_append(out, info->html_name.data(), info->html_name.length());
+            arena_text_append_str(out, "'>\r\n");
+            wb_type_value_html(wbd, i, out);
+            arena_text_append_str(out, "</td>\r\n");
+        }
+        else
+            arena_text_append(out, info->html_name.data(), info->html_name.length());
+        arena_text_append_str(out, "</td>\r\n");
+        arena_text_append_str(out, "</tr>\r\n");
+    }
+    else if(row == GSW_NUM_TYPES_DEFINED + 1)
+    {
+        arena_text_append_str(out, "</table>\r\n");
+        const std::string &tail = html_page_tail();
+        arena_text_append(out, tail.data(), tail.length());
+    }
+    else
+        return false;
+    return true;
+}
+
+void handle_get_request_html(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header)
+{
+    //the page head, scripts and styles are static, only the content is rendered here
+    arena_text response;
+    arena_text_init(&response, &conn->scratch);
+    char etag[WB_ETAG_SIZE];
+    etag[0] = '\0';
+
+    if(url_is_root(header))
+    {   //URL == /           - all messages, array
+        wb_all_types_etag(wbd, header->accept, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+        if(not_modified(conn, header, etag))
+            return;
+        char headers[ETAG_HEADERS_SIZE];
+        response_stream_begin(conn, wbd, header->version, Content_Type_Strings[header->accept], etag_headers(etag, headers), html_listing_row);
+        return;
+    } 
+    else 
+    {   //URL == /$(msg) 
+        http_string msg_name;
+        int type = url_message_type(header, &msg_name);
+        if(msg_name.length == 0)
+        {
+            generate_response(conn, header->version, _404_Not_Found, header->accept, "");
+            return;
+        }
+        if(type != -1)
+        {
+            wb_type_etag(wbd, type, header->accept, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+            if(not_modified(conn, header, etag))
+                return;
+        }
+        arena_text_append_str(&response, "<h1>");
+        if(type != -1)
+            arena_text_append(&response, wb_type(type)->html_name.data(), wb_type(type)->html_name.length());
+        else
+            html_append_escaped(&response, msg_name.data, msg_name.length); //straight from the URL
+        arena_text_append_str(&response, "</h1>\r\n"
+		"<form id='form' method='POST' >\r\n"
+		"<div>\r\n"
+  		"	<textarea id='textarea' rows='20'>");
+        if(type != -1)
+            wb_type_value_html(wbd, type, &response);
+        else
+            arena_text_append_str(&response, "##unsupported##");
+		arena_text_append_str(&response, "</textarea>"
+		"</div>\r\n"
+		"<div class='buttons'>\r\n"
+  		"	<input id='submit' type='submit' />\r\n"
+		"</div>\r\n"
+		"	</form>\r\n");
+    } 
+
+    const std::string &head = html_page_head();
+    const std::string &tail = html_page_tail();
+    body_part page[3] =
+    {
+        { head.data(), head.length(), true },
+        { response.data, response.length, false },
+        { tail.data(), tail.length(), true }
+    };
+    char headers[ETAG_HEADERS_SIZE];
+    generate_response_parts(conn, header->version, _200_OK, Content_Type_Strings[header->accept], page, 3, etag_headers(etag, headers));
+}
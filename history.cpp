@@ -0,0 +1,367 @@
+/**
+ *  /file guwhiteboardwebposter/history.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+#include "gusimplewhiteboard.h"
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "cbor.h"
+#include "history.h"
+#include "json.h"
+#include "server.h"
+#include "wb_types.h"
+
+/** one recorded value, its bytes are in the ring's data */
+typedef struct history_entry_s
+{
+    uint64_t timestamp_us;      ///< when it was sampled, microseconds since the epoch, increasing
+    uint32_t offset;            ///< where the value starts in the ring's data, it can wrap round the end
+    uint32_t length;
+    uint16_t event_counter;     ///< the type's event counter the slot was copied at
+} history_entry;
+
+/**
+ * A type's recorded values.  Both the index and the value bytes are rings
+ * allocated once, so recording never allocates and memory stays fixed.
+ * The values are stored in order, the oldest at the first entry's offset.
+ */
+typedef struct history_ring_s
+{
+    std::mutex lock;            ///< held by the sampler to add an entry and by a request to copy some out
+    history_entry *entries;
+    size_t capacity;            ///< entries the index holds
+    size_t first;               ///< index of the oldest entry
+    size_t count;
+    char *data;
+    size_t size;                ///< bytes of value the ring holds
+    size_t head;                ///< where the next value goes
+    size_t used;                ///< bytes of value held
+    uint64_t dropped_until_us;  ///< timestamp of the newest entry dropped to make room, 0 if none has been
+} history_ring;
+
+typedef struct history_sampler_s
+{
+    std::mutex lock;
+    std::condition_variable wake;       ///< the sampler is stopping
+    bool stopping;
+    std::vector<int> types;             ///< types being recorded
+    std::vector<uint16_t> counters;     ///< event counter each was last sampled at, by position in 'types'
+    std::vector<bool> sampled;          ///< whether it has been sampled at all yet
+    gu_simple_whiteboard_descriptor *wbd; ///< the sampler's own descriptor
+    std::thread *thread;
+} history_sampler;
+
+//allocated once for the life of the server, the rings are read by requests on every worker
+static history_sampler *sampler = nullptr;
+static std::vector<history_ring *> rings;   ///< by type, nullptr for types not being recorded
+
+static uint64_t realtime_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+static history_ring *ring_new(size_t bytes)
+{
+    history_ring *ring = new history_ring();
+    ring->capacity = bytes / (HISTORY_ENTRY_ESTIMATE + sizeof(history_entry));
+    ring->entries = new history_entry[ring->capacity];
+    ring->size = bytes - ring->capacity * sizeof(history_entry);
+    ring->data = new char[ring->size];
+    ring->first = 0;
+    ring->count = 0;
+    ring->head = 0;
+    ring->used = 0;
+    ring->dropped_until_us = 0;
+    return ring;
+}
+
+static void ring_free(history_ring *ring)
+{
+    delete[] ring->entries;
+    delete[] ring->data;
+    delete ring;
+}
+
+/** Adds a value, dropping the oldest entries until it fits. */
+static void ring_push(history_ring *ring, uint64_t timestamp_us, uint16_t event_counter, const char *value, size_t length)
+{
+    if(length > ring->size)
+        length = ring->size;
+    std::lock_guard<std::mutex> lock(ring->lock);
+    while(ring->count > 0 && (ring->count == ring->capacity || ring->used + length > ring->size))
+    {
+        const history_entry *oldest = &ring->entries[ring->first];
+        ring->used -= oldest->length;
+        ring->dropped_until_us = oldest->timestamp_us;
+        ring->first = (ring->first + 1) % ring->capacity;
+        ring->count--;
+    }
+
+    history_entry *entry = &ring->entries[(ring->first + ring->count) % ring->capacity];
+    if(ring->count > 0)
+    {   //keeps 'since' queries exact if the wall clock steps back
+        const history_entry *newest = &ring->entries[(ring->first + ring->count - 1) % ring->capacity];
+        if(timestamp_us <= newest->timestamp_us)
+            timestamp_us = newest->timestamp_us + 1;
+    }
+    entry->timestamp_us = timestamp_us;
+    entry->offset = static_cast<uint32_t>(ring->head);
+    entry->length = static_cast<uint32_t>(length);
+    entry->event_counter = event_counter;
+    size_t part = ring->size - ring->head < length ? ring->size - ring->head : length;
+    memcpy(ring->data + ring->head, value, part);
+    memcpy(ring->data, value + part, length - part);
+    ring->head = (ring->head + length) % ring->size;
+    ring->used += length;
+    ring->count++;
+}
+
+/**
+ * Polls the event counters without any lock, and copies out only the slots
+ * that moved, one at a time, so a post never waits on more than one copy.
+ */
+static void sample_run(void)
+{
+    gu_simple_message *message = new gu_simple_message();
+    std::unique_lock<std::mutex> lock(sampler->lock);
+    while(!sampler->stopping)
+    {
+        lock.unlock();
+        for(size_t i = 0; i < sampler->types.size(); i++)
+        {
+            int type = sampler->types[i];
+            uint16_t counter = wb_type_event_counter(sampler->wbd, type);
+            if(sampler->sampled[i] && counter == sampler->counters[i])
+                continue;
+            wb_copy_slot(sampler->wbd, type, message, &counter);
+            uint64_t now = realtime_us();
+            char *value = whiteboard_getmsg(type, message);
+            ring_push(rings[static_cast<size_t>(type)], now, counter, value, strlen(value));
+            free(value);
+            sampler->counters[i] = counter;
+            sampler->sampled[i] = true;
+        }
+        lock.lock();
+        sampler->wake.wait_for(lock, std::chrono::milliseconds(HISTORY_SAMPLE_INTERVAL_MS), [] { return sampler->stopping; });
+    }
+    delete message;
+}
+
+/** Frees what history_start() had set up when it can't start the sampler. */
+static void history_discard(void)
+{
+    for(size_t i = 0; i < rings.size(); i++)
+        if(rings[i])
+            ring_free(rings[i]);
+    rings.clear();
+    delete sampler;
+    sampler = nullptr;
+}
+
+bool history_start(const char *wbname, const int *types, size_t count, size_t bytes)
+{
+    if(bytes < HISTORY_MIN_SIZE)
+        bytes = HISTORY_MIN_SIZE;
+    sampler = new history_sampler();
+    sampler->stopping = false;
+    rings.assign(GSW_NUM_TYPES_DEFINED, nullptr);
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t type = static_cast<size_t>(types[i]);
+        if(!wb_type(types[i])->parsable || rings[type])
+            continue;
+        rings[type] = ring_new(bytes);
+        sampler->types.push_back(types[i]);
+    }
+    sampler->counters.assign(sampler->types.size(), 0);
+    sampler->sampled.assign(sampler->types.size(), false);
+    if(sampler->types.empty())
+    {
+        fprintf(stderr, "No parsable types to record history for\n");
+        history_discard();
+        return false;
+    }
+    sampler->wbd = gsw_new_whiteboard(wbname);
+    if(!sampler->wbd)
+    {
+        history_discard();
+        return false;
+    }
+    sampler->thread = new std::thread(sample_run);
+    fprintf(stderr, "Recording the history of %zu types, %zu bytes each\n", sampler->types.size(), bytes);
+    return true;
+}
+
+void history_stop(void)
+{
+    if(!sampler || !sampler->thread)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(sampler->lock);
+        sampler->stopping = true;
+    }
+    sampler->wake.notify_one();
+    sampler->thread->join();
+    delete sampler->thread;
+    sampler->thread = nullptr;
+    gsw_free_whiteboard(sampler->wbd);
+}
+
+/** Reads an unsigned decimal query parameter, false if it's there but isn't one. */
+static bool query_number(http_string url, const char *name, uint64_t *value, bool *present)
+{
+    http_string s;
+    *present = http_query_param(url, name, &s);
+    if(!*present)
+        return true;
+    if(s.length == 0 || s.length > 19)
+        return false;
+    uint64_t n = 0;
+    for(size_t i = 0; i < s.length; i++)
+    {
+        if(s.data[i] < '0' || s.data[i] > '9')
+            return false;
+        n = n * 10 + static_cast<uint64_t>(s.data[i] - '0');
+    }
+    *value = n;
+    return true;
+}
+
+void handle_history(struct connection_s *conn, struct header_info_s *header)
+{
+    enum Content_Type representation = header->accept == Application_cbor ? Application_cbor
+                                     : header->accept == Application_vnd_api_json ? Application_vnd_api_json : Application_json;
+    http_string path = http_url_path(header->url);
+    int type = wb_find_type(path.data + 9, path.length - 9); //after '/history/'
+    history_ring *ring = type != -1 && !rings.empty() ? rings[static_cast<size_t>(type)] : nullptr;
+    if(!ring)
+    {
+        generate_response(conn, header->version, _404_Not_Found, representation, "");
+        return;
+    }
+    uint64_t since = 0;
+    uint64_t limit = HISTORY_DEFAULT_LIMIT;
+    bool has_since;
+    bool has_limit;
+    if(!query_number(header->url, "since", &since, &has_since)
+    || !query_number(header->url, "limit", &limit, &has_limit)
+    || limit == 0 || limit > HISTORY_MAX_LIMIT)
+    {
+        generate_response(conn, header->version, _400_Bad_Request, representation, "");
+        return;
+    }
+
+    //the entries and their values are copied out under the ring's lock, and serialised after
+    arena *scratch = &conn->scratch;
+    history_entry *entries;
+    char *values;
+    size_t count;
+    bool dropped;
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(ring->lock);
+        size_t start;
+        if(has_since)
+        {   //entries are in timestamp order, find the first one after 'since'
+            size_t low = 0;
+            size_t high = ring->count;
+            while(low < high)
+            {
+                size_t middle = low + (high - low) / 2;
+                if(ring->entries[(ring->first + middle) % ring->capacity].timestamp_us <= since)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            start = low;
+        }
+        else
+            start = ring->count > limit ? ring->count - limit : 0;
+        count = ring->count - start < limit ? ring->count - start : static_cast<size_t>(limit);
+        more = start + count < ring->count;
+        dropped = has_since ? ring->dropped_until_us > since : count < limit && ring->dropped_until_us != 0;
+
+        size_t bytes = 0;
+        entries = static_cast<history_entry *>(arena_alloc(scratch, count * sizeof(history_entry) + 1));
+        for(size_t i = 0; i < count; i++)
+        {
+            entries[i] = ring->entries[(ring->first + start + i) % ring->capacity];
+            bytes += entries[i].length;
+        }
+        values = static_cast<char *>(arena_alloc(scratch, bytes + 1));
+        size_t offset = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            size_t length = entries[i].length;
+            size_t part = ring->size - entries[i].offset < length ? ring->size - entries[i].offset : length;
+            memcpy(values + offset, ring->data + entries[i].offset, part);
+            memcpy(values + offset + part, ring->data, length - part);
+            entries[i].offset = static_cast<uint32_t>(offset); //now into 'values'
+            offset += length;
+        }
+    }
+
+    const wb_type_info *info = wb_type(type);
+    arena_text response;
+    arena_text_init(&response, scratch);
+    if(representation == Application_cbor)
+    {   //{"type": name, "dropped": bool, "more": bool, "entries": [{"ts": us, "event_counter": n, "value": text}, ...]}
+        cbor_put_map(&response, 4);
+        cbor_put_text_str(&response, "type");
+        arena_text_append(&response, info->cbor_name.data(), info->cbor_name.length());
+        cbor_put_text_str(&response, "dropped");
+        cbor_put_bool(&response, dropped);
+        cbor_put_text_str(&response, "more");
+        cbor_put_bool(&response, more);
+        cbor_put_text_str(&response, "entries");
+        cbor_put_array(&response, count);
+        for(size_t i = 0; i < count; i++)
+        {
+            cbor_put_map(&response, 3);
+            cbor_put_text_str(&response, "ts");
+            cbor_put_uint(&response, entries[i].timestamp_us);
+            cbor_put_text_str(&response, "event_counter");
+            cbor_put_uint(&response, entries[i].event_counter);
+            cbor_put_text_str(&response, "value");
+            cbor_put_text(&response, values + entries[i].offset, entries[i].length);
+        }
+    }
+    else
+    {
+        arena_text_append_str(&response, "{\"type\":");
+        arena_text_append(&response, info->json_name.data(), info->json_name.length());
+        arena_text_append_str(&response, dropped ? ", \"dropped\":true" : ", \"dropped\":false");
+        arena_text_append_str(&response, more ? ", \"more\":true" : ", \"more\":false");
+        arena_text_append_str(&response, ", \"entries\":[\r\n");
+        for(size_t i = 0; i < count; i++)
+        {
+            char number[96];
+            int n = snprintf(number, sizeof(number), "%s\t{\"ts\":%llu, \"event_counter\":%u, \"value\":", i > 0 ? ",\r\n" : "",
+                             static_cast<unsigned long long>(entries[i].timestamp_us), static_cast<unsigned>(entries[i].event_counter));
+            arena_text_append(&response, number, static_cast<size_t>(n));
+            json_append_string(&response, values + entries[i].offset, entries[i].length);
+            arena_text_append_str(&response, "}");
+        }
+        arena_text_append_str(&response, "\r\n]}");
+    }
+    body_part body = { response.data, response.length, false };
+    generate_response_parts(conn, header->version, _200_OK, Content_Type_Strings[representation], &body, 1, "Cache-Control: no-cache\r\n");
+}
@@ -0,0 +1,43 @@
+/**
+ *  /file guwhiteboardwebposter/history.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstddef>
+
+#include "guwhiteboardwebposter.h"
+
+#define HISTORY_SAMPLE_INTERVAL_MS 5    ///< how often the sampler looks at the event counters
+#define HISTORY_ENTRY_ESTIMATE 64       ///< bytes of value per entry a ring is sized for, more entries fit if values are shorter
+#define HISTORY_MIN_SIZE 4096           ///< smallest per type budget accepted, bytes
+#define HISTORY_DEFAULT_LIMIT 100       ///< entries answered when the request doesn't say
+#define HISTORY_MAX_LIMIT 10000         ///< most entries one request can ask for
+
+/**
+ * Starts the sampler thread, on its own descriptor for 'wbname'.  It records
+ * a timestamped, serialised value for each of the 'count' types every time
+ * the type's event counter has moved since it last looked, into a ring of
+ * 'bytes' per type.  The ring's index and values both come out of that
+ * budget, the oldest entries are dropped to make room, and a value bigger
+ * than the whole ring is cut short.  Types without a string getter are skipped.
+ */
+bool history_start(const char *wbname, const int *types, size_t count, size_t bytes);
+
+/** Stops the sampler thread, the recorded entries stay readable. */
+void history_stop(void);
+
+/**
+ * GET /history/<type>?since=<us>&limit=<n> answers a recorded type's values
+ * as JSON or CBOR, oldest first.  'since' is microseconds since the epoch and
+ * only entries recorded after it are answered, up to 'limit' of them; without
+ * it the latest 'limit' entries are.  404 if the type isn't being recorded.
+ */
+void handle_history(struct connection_s *conn, struct header_info_s *header);
+
+#endif //HISTORY_H
@@ -0,0 +1,495 @@
+/**
+ *  /file guwhiteboardwebposter/http_parser.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "http_parser.h"
+
+const char *HTTP_Verb_Strings[] =
+{
+        "GET",
+        "HEAD",
+        "POST",
+        "PUT",
+        "DELETE",
+        "TRACE",
+        "OPTIONS",
+        "CONNECT",
+        "PATCH"
+};
+
+const char *HTTP_Code_Strings[] =
+{
+        "200 OK",
+        "201 Created",
+        "202 Accepted",
+        "204 No Content",
+        "304 Not Modified",
+        "400 Bad Request",
+        "422 Unprocessable Entity",
+        "404 Not Found",
+        "411 Length Required",
+        "413 Payload Too Large",
+        "415 Unsupported Media Type",
+        "418 I'm a teapot",
+        "501 Not Implemented"
+};
+
+const char *HTTP_Version_Strings[] =
+{
+        "HTTP/1.0",
+        "HTTP/1.1"
+};
+
+const char *Content_Type_Strings[] =
+{
+        "text/html",
+        "application/vnd.api+json",
+        "application/json",
+        "text/event-stream",
+        "application/cbor",
+        "application/octet-stream",
+        "*/*"
+};
+
+const char *Content_Encoding_Strings[] =
+{
+        "identity",
+        "gzip",
+        "deflate"
+};
+
+const char *Content_Encoding_ETag_Suffixes[] =
+{
+        "",
+        "-gz",
+        "-df"
+};
+
+static inline char ascii_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+static inline bool is_ows(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/** control characters, space and DEL can't appear in a method, target or field name */
+static inline bool is_token_char(char c)
+{
+    unsigned char u = static_cast<unsigned char>(c);
+    return u > ' ' && u != 0x7f;
+}
+
+static http_string trim(http_string s)
+{
+    while(s.length > 0 && is_ows(s.data[0]))
+    {
+        s.data++;
+        s.length--;
+    }
+    while(s.length > 0 && is_ows(s.data[s.length - 1]))
+        s.length--;
+    return s;
+}
+
+bool http_string_equals(http_string s, const char *literal)
+{
+    size_t length = strlen(literal);
+    return s.length == length && memcmp(s.data, literal, length) == 0;
+}
+
+bool http_string_iequals(http_string s, const char *literal)
+{
+    size_t length = strlen(literal);
+    if(s.length != length)
+        return false;
+    for(size_t i = 0; i < length; i++)
+        if(ascii_lower(s.data[i]) != ascii_lower(literal[i]))
+            return false;
+    return true;
+}
+
+bool http_string_has_token(http_string s, const char *token)
+{
+    const char *p = s.data;
+    const char *end = s.data + s.length;
+    while(p < end)
+    {
+        const char *comma = static_cast<const char *>(memchr(p, ',', static_cast<size_t>(end - p)));
+        const char *item_end = comma ? comma : end;
+        http_string item = { p, static_cast<size_t>(item_end - p) };
+        if(http_string_iequals(trim(item), token))
+            return true;
+        p = item_end + 1;
+    }
+    return false;
+}
+
+bool http_etag_matches(http_string if_none_match, const char *etag)
+{
+    http_string value = trim(if_none_match);
+    if(http_string_equals(value, "*"))
+        return true;
+    const char *p = value.data;
+    const char *end = value.data + value.length;
+    while(p < end)
+    {
+        const char *comma = static_cast<const char *>(memchr(p, ',', static_cast<size_t>(end - p)));
+        const char *item_end = comma ? comma : end;
+        http_string tag = { p, static_cast<size_t>(item_end - p) };
+        tag = trim(tag);
+        if(tag.length > 2 && tag.data[0] == 'W' && tag.data[1] == '/')
+        {
+            tag.data += 2;
+            tag.length -= 2;
+        }
+        if(http_string_equals(tag, etag))
+            return true;
+        p = item_end + 1;
+    }
+    return false;
+}
+
+http_string http_url_path(http_string url)
+{
+    const char *query = static_cast<const char *>(memchr(url.data, '?', url.length));
+    if(query)
+        url.length = static_cast<size_t>(query - url.data);
+    return url;
+}
+
+bool http_query_param(http_string url, const char *name, http_string *value)
+{
+    const char *query = static_cast<const char *>(memchr(url.data, '?', url.length));
+    if(!query)
+        return false;
+    size_t name_length = strlen(name);
+    const char *p = query + 1;
+    const char *end = url.data + url.length;
+    while(p < end)
+    {
+        const char *amp = static_cast<const char *>(memchr(p, '&', static_cast<size_t>(end - p)));
+        const char *item_end = amp ? amp : end;
+        if(static_cast<size_t>(item_end - p) >= name_length && memcmp(p, name, name_length) == 0)
+        {
+            const char *v = p + name_length;
+            if(v == item_end || *v == '=')
+            {
+                value->data = v == item_end ? v : v + 1;
+                value->length = static_cast<size_t>(item_end - value->data);
+                return true;
+            }
+        }
+        p = item_end + 1;
+    }
+    return false;
+}
+
+/**
+ * Reads one token up to 'delimiter', rejecting anything that can't appear in it.
+ */
+static bool read_token(const char **p, const char *end, char delimiter, http_string *token)
+{
+    const char *start = *p;
+    const char *c = start;
+    while(c < end && *c != delimiter)
+    {
+        if(!is_token_char(*c))
+            return false;
+        c++;
+    }
+    if(c == end || c == start)
+        return false;
+    token->data = start;
+    token->length = static_cast<size_t>(c - start);
+    *p = c + 1;
+    return true;
+}
+
+/**
+ * Reads the rest of a line up to its CRLF.
+ */
+static bool read_line(const char **p, const char *end, http_string *line)
+{
+    const char *start = *p;
+    const char *cr = static_cast<const char *>(memchr(start, '\r', static_cast<size_t>(end - start)));
+    if(!cr || end - cr < 2 || cr[1] != '\n')
+        return false;
+    if(memchr(start, '\n', static_cast<size_t>(cr - start)) != nullptr)
+        return false; //bare LF
+    line->data = start;
+    line->length = static_cast<size_t>(cr - start);
+    *p = cr + 2;
+    return true;
+}
+
+bool http_parse_request(const char *header, size_t length, http_request *request)
+{
+    const char *p = header;
+    const char *end = header + length;
+    request->num_fields = 0;
+
+    //request line
+    if(!read_token(&p, end, ' ', &request->method) ||
+       !read_token(&p, end, ' ', &request->target) ||
+       !read_line(&p, end, &request->version))
+        return false;
+    for(size_t i = 0; i < request->version.length; i++)
+        if(!is_token_char(request->version.data[i]))
+            return false;
+
+    //fields, until the blank line
+    while(true)
+    {
+        if(end - p < 2)
+            return false; //no terminating blank line
+        if(p[0] == '\r' && p[1] == '\n')
+            return true;
+        if(request->num_fields == HTTP_MAX_HEADER_FIELDS)
+            return false;
+        http_header_field *field = &request->fields[request->num_fields];
+        if(!read_token(&p, end, ':', &field->name) || !read_line(&p, end, &field->value))
+            return false;
+        field->value = trim(field->value);
+        request->num_fields++;
+    }
+}
+
+const http_string *http_find_field(const http_request *request, const char *name)
+{
+    for(int i = 0; i < request->num_fields; i++)
+        if(http_string_iequals(request->fields[i].name, name))
+            return &request->fields[i].value;
+    return nullptr;
+}
+
+/**
+ * Strict decimal parse, rejects signs, junk and anything that doesn't fit an int.
+ */
+static bool parse_content_length(http_string s, int *content_length)
+{
+    if(s.length == 0)
+        return false;
+    long long value = 0;
+    for(size_t i = 0; i < s.length; i++)
+    {
+        if(s.data[i] < '0' || s.data[i] > '9')
+            return false;
+        value = value * 10 + (s.data[i] - '0');
+        if(value > INT_MAX)
+            return false;
+    }
+    *content_length = static_cast<int>(value);
+    return true;
+}
+
+bool parse_header(const char *header, size_t length, struct header_info_s *header_s)
+{
+    http_request *request = &header_s->request;
+    if(!http_parse_request(header, length, request))
+        return false;
+#ifdef PARSE_DEBUG
+    fprintf(stderr, "Header Field Parser, Field 'HTTP Verb' = '%.*s'\n", static_cast<int>(request->method.length), request->method.data);
+    fprintf(stderr, "Header Field Parser, Field 'URL' = '%.*s'\n", static_cast<int>(request->target.length), request->target.data);
+    fprintf(stderr, "Header Field Parser, Field 'HTTP Version' = '%.*s'\n", static_cast<int>(request->version.length), request->version.data);
+    for(int i = 0; i < request->num_fields; i++)
+        fprintf(stderr, "Header Field Parser, Field '%.*s' = '%.*s'\n",
+                static_cast<int>(request->fields[i].name.length), request->fields[i].name.data,
+                static_cast<int>(request->fields[i].value.length), request->fields[i].value.data);
+#endif
+    header_s->verb = parse_verb(request->method);
+    header_s->version = parse_version(request->version);
+    header_s->url = request->target;
+
+    //pick out the fields we care about in one pass over the header
+    const http_string *connection = nullptr;
+    const http_string *accept = nullptr;
+    const http_string *content_type = nullptr;
+    const http_string *content_length = nullptr;
+    const http_string *accept_encoding = nullptr;
+    const http_string *transfer_encoding = nullptr;
+    const http_string *expect = nullptr;
+    for(int i = 0; i < request->num_fields; i++)
+    {
+        http_string name = request->fields[i].name;
+        const http_string *value = &request->fields[i].value;
+        if(http_string_iequals(name, "Accept"))
+            accept = value;
+        else if(http_string_iequals(name, "Connection"))
+            connection = value;
+        else if(http_string_iequals(name, "Content-Type"))
+            content_type = value;
+        else if(http_string_iequals(name, "Content-Length"))
+            content_length = value;
+        else if(http_string_iequals(name, "Accept-Encoding"))
+            accept_encoding = value;
+        else if(http_string_iequals(name, "Transfer-Encoding"))
+            transfer_encoding = value;
+        else if(http_string_iequals(name, "Expect"))
+            expect = value;
+    }
+
+    //HTTP/1.1 connections persist unless the client says otherwise, HTTP/1.0 ones only if asked
+    if(connection) //Optional
+        header_s->keep_alive = header_s->version == HTTP_V1_1 ? !http_string_has_token(*connection, "close") : http_string_has_token(*connection, "keep-alive");
+    else
+        header_s->keep_alive = header_s->version == HTTP_V1_1;
+
+    //get fields
+    if(accept == nullptr || accept->length == 0)
+        return false;
+    header_s->accept = parse_content_type(*accept);
+    if(header_s->accept == NUM_SUPPORTED_CONTENT_TYPES)
+        return false;
+
+    header_s->accept_encoding = accept_encoding ? parse_accept_encoding(*accept_encoding) : Encoding_Identity; //Optional
+
+    if(content_type) //Optional
+        header_s->content_type = parse_content_type(*content_type);
+
+    if(content_length) //Optional
+    {
+        if(!parse_content_length(*content_length, &header_s->content_length))
+            return false;
+    }
+    else
+        header_s->content_length = -1;
+
+    //chunked is the only transfer coding we decode, anything else can't be framed
+    if(transfer_encoding) //Optional
+    {
+        if(!http_string_iequals(*transfer_encoding, "chunked"))
+            return false;
+        header_s->chunked = true;
+    }
+    header_s->expect_continue = expect && http_string_iequals(*expect, "100-continue"); //Optional
+
+    return true;
+}
+
+enum Content_Type parse_content_type(http_string content_type)
+{
+    const char *p = content_type.data;
+    const char *end = content_type.data + content_type.length;
+    while(p < end)
+    {
+        const char *comma = static_cast<const char *>(memchr(p, ',', static_cast<size_t>(end - p)));
+        const char *item_end = comma ? comma : end;
+        //drop parameters such as ';q=0.9' or ';charset=UTF-8'
+        const char *semicolon = static_cast<const char *>(memchr(p, ';', static_cast<size_t>(item_end - p)));
+        http_string type = { p, static_cast<size_t>((semicolon ? semicolon : item_end) - p) };
+        type = trim(type);
+        for(int i = 0; i < NUM_SUPPORTED_CONTENT_TYPES; i++)
+        {
+            if(http_string_iequals(type, Content_Type_Strings[i]))
+            {
+#ifdef PARSE_DEBUG
+                fprintf(stderr, "Found Supported Content Type: '%s'\n", Content_Type_Strings[i]);
+#endif
+                return static_cast<enum Content_Type>(i);
+            }
+        }
+        p = item_end + 1;
+    }
+    return NUM_SUPPORTED_CONTENT_TYPES; //Not Supported
+}
+
+/**
+ * Whether a ';q=' parameter rules a coding out.
+ */
+static bool quality_is_zero(http_string params)
+{
+    const char *q = params.data;
+    const char *end = params.data + params.length;
+    while(q < end && (*q == ';' || is_ows(*q)))
+        q++;
+    if(end - q < 2 || ascii_lower(q[0]) != 'q' || q[1] != '=')
+        return false;
+    for(q += 2; q < end; q++)
+        if(*q != '0' && *q != '.' && !is_ows(*q))
+            return false;
+    return true;
+}
+
+enum Content_Encoding parse_accept_encoding(http_string accept_encoding)
+{
+    bool gzip = false;
+    bool deflate = false;
+    bool any = false;
+    //a coding refused with q=0 isn't taken through '*' either
+    bool gzip_refused = false;
+    bool deflate_refused = false;
+    const char *p = accept_encoding.data;
+    const char *end = accept_encoding.data + accept_encoding.length;
+    while(p < end)
+    {
+        const char *comma = static_cast<const char *>(memchr(p, ',', static_cast<size_t>(end - p)));
+        const char *item_end = comma ? comma : end;
+        const char *semicolon = static_cast<const char *>(memchr(p, ';', static_cast<size_t>(item_end - p)));
+        http_string coding = { p, static_cast<size_t>((semicolon ? semicolon : item_end) - p) };
+        coding = trim(coding);
+        http_string params = { semicolon ? semicolon : item_end, static_cast<size_t>(item_end - (semicolon ? semicolon : item_end)) };
+        bool refused = quality_is_zero(params);
+        if(http_string_iequals(coding, "gzip"))
+        {
+            gzip = gzip || !refused;
+            gzip_refused = gzip_refused || refused;
+        }
+        else if(http_string_iequals(coding, "deflate"))
+        {
+            deflate = deflate || !refused;
+            deflate_refused = deflate_refused || refused;
+        }
+        else if(http_string_equals(coding, "*"))
+            any = any || !refused;
+        p = item_end + 1;
+    }
+    gzip = (gzip || any) && !gzip_refused;
+    deflate = (deflate || any) && !deflate_refused;
+    //gzip first, some old clients mean raw deflate by 'deflate'
+    return gzip ? Encoding_Gzip : deflate ? Encoding_Deflate : Encoding_Identity;
+}
+
+enum HTTP_Version parse_version(http_string version)
+{
+    if(http_string_equals(version, "HTTP/1.0"))
+        return HTTP_V1;
+    else if(http_string_equals(version, "HTTP/1.1"))
+        return HTTP_V1_1;
+    else
+        return UNKNOWN_HTTP_VERSION;
+}
+
+enum HTTP_Verb parse_verb(http_string verb)
+{
+    if(http_string_equals(verb, "GET"))
+        return HTTP_GET;
+    else if(http_string_equals(verb, "HEAD"))
+        return HTTP_HEAD;
+    else if(http_string_equals(verb, "POST"))
+        return HTTP_POST;
+    else if(http_string_equals(verb, "PUT"))
+        return HTTP_PUT;
+    else if(http_string_equals(verb, "DELETE"))
+        return HTTP_DELETE;
+    else if(http_string_equals(verb, "TRACE"))
+        return HTTP_TRACE;
+    else if(http_string_equals(verb, "OPTIONS"))
+        return HTTP_OPTIONS;
+    else if(http_string_equals(verb, "CONNECT"))
+        return HTTP_CONNECT;
+    else if(http_string_equals(verb, "PATCH"))
+        return HTTP_PATCH;
+    else
+        return HTTP_UNKNOWN;
+}
@@ -0,0 +1,165 @@
+/**
+ *  /file guwhiteboardwebposter/http_parser.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <cstddef>
+
+enum HTTP_Verb
+{
+    HTTP_GET = 0,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_DELETE,
+    HTTP_TRACE,
+    HTTP_OPTIONS,
+    HTTP_CONNECT,
+    HTTP_PATCH,
+    NUM_HTTP_VERBS,
+    HTTP_UNKNOWN
+};
+
+extern const char *HTTP_Verb_Strings[];
+
+enum HTTP_Code
+{
+    //compiler reuqires that variable names not start with a number, added underscore prefix
+    _200_OK = 0,
+    _201_Created,
+    _202_Accepted,
+    _204_No_Content,
+    _304_Not_Modified,
+    _400_Bad_Request,
+    _422_Unprocessable_Entity,
+    _404_Not_Found,
+    _411_Length_Required,
+    _413_Payload_Too_Large,
+    _415_Unsupported_Media_Type,
+    _418_Im_a_teapot,
+    _501_Not_Implemented,
+    NUM_HTTP_CODES,
+    UNKNOWN_HTTP_CODE
+};
+
+extern const char *HTTP_Code_Strings[];
+
+enum HTTP_Version
+{
+    HTTP_V1 = 0,
+    HTTP_V1_1,
+    NUM_HTTP_VERSIONS,
+    UNKNOWN_HTTP_VERSION
+};
+
+extern const char *HTTP_Version_Strings[];
+
+enum Content_Type
+{
+    Text_HTML = 0,
+    Application_vnd_api_json,
+    Application_json,
+    Text_Event_Stream,
+    Application_cbor,
+    Application_octet_stream,
+    WildCard,
+    NUM_SUPPORTED_CONTENT_TYPES
+};
+
+extern const char *Content_Type_Strings[];
+
+enum Content_Encoding
+{
+    Encoding_Identity = 0,
+    Encoding_Gzip,
+    Encoding_Deflate,
+    NUM_CONTENT_ENCODINGS
+};
+
+extern const char *Content_Encoding_Strings[];
+extern const char *Content_Encoding_ETag_Suffixes[]; ///< keeps a strong ETag distinct for each coding of a body
+
+/** a view into the request buffer, not NUL terminated */
+typedef struct http_string_s
+{
+    const char *data;
+    size_t length;
+} http_string;
+
+typedef struct http_header_field_s
+{
+    http_string name;
+    http_string value;          ///< without surrounding whitespace
+} http_header_field;
+
+#define HTTP_MAX_HEADER_FIELDS 32   ///< requests with more fields are rejected
+
+/** tokenised request header, every string points into the buffer that was parsed */
+typedef struct http_request_s
+{
+    http_string method;
+    http_string target;
+    http_string version;
+    http_header_field fields[HTTP_MAX_HEADER_FIELDS];
+    int num_fields;
+} http_request;
+
+struct header_info_s
+{
+    enum HTTP_Verb verb;
+    http_string url;            ///< request target, only valid until the request has been handled
+    enum HTTP_Version version;
+    enum Content_Type content_type;
+    int content_length;         ///< -1 if not given, set to the decoded length once a chunked body has been received
+    enum Content_Type accept;
+    bool keep_alive;            ///< client wants a persistent connection
+    enum Content_Encoding accept_encoding; ///< best compression the client takes, from 'Accept-Encoding'
+    bool chunked;               ///< body is sent with 'Transfer-Encoding: chunked'
+    bool expect_continue;       ///< client waits for '100 Continue' before sending the body
+    http_request request;       ///< all of the header's fields
+};
+
+/**
+ * Tokenises a request header in a single pass without copying or allocating.
+ * 'header' must hold the whole header including the terminating blank line.
+ */
+bool http_parse_request(const char *header, size_t length, http_request *request);
+
+/** Case insensitive field lookup, returns nullptr if the field isn't there. */
+const http_string *http_find_field(const http_request *request, const char *name);
+
+bool http_string_equals(http_string s, const char *literal);
+bool http_string_iequals(http_string s, const char *literal);
+
+/** Whether a comma separated field value (e.g. 'Connection') lists token, ignoring case. */
+bool http_string_has_token(http_string s, const char *token);
+
+/**
+ * Whether an 'If-None-Match' value lists etag (or is '*').
+ * Uses the weak comparison RFC 7232 asks for, so a 'W/' prefix is ignored.
+ */
+bool http_etag_matches(http_string if_none_match, const char *etag);
+
+/** The path part of a request target, without the query string. */
+http_string http_url_path(http_string url);
+
+/**
+ * Finds 'name=value' in the query string of a request target.
+ * The value is returned as is, still percent encoded.
+ */
+bool http_query_param(http_string url, const char *name, http_string *value);
+
+//Parser functions
+bool parse_header(const char *header, size_t length, struct header_info_s *header_s);
+enum HTTP_Verb parse_verb(http_string verb);
+enum HTTP_Version parse_version(http_string version);
+enum Content_Type parse_content_type(http_string content_type);
+enum Content_Encoding parse_accept_encoding(http_string accept_encoding);
+
+#endif //HTTP_PARSER_H
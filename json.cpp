@@ -0,0 +1,436 @@
+/**
+ *  /file guwhiteboardwebposter/json.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cctype>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define JSON_NEON
+#endif
+
+#include "json.h"
+
+static inline bool is_special(char c)
+{
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+/**
+ * First character from p that can't be copied into or out of a JSON string
+ * as it is: a quote, a backslash or a control character.  Returns end if
+ * there isn't one.
+ */
+static const char *find_special(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    for(; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v)); //v <= 0x1f, unsigned
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if(mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+#elif defined(JSON_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    for(; end - p >= 16; p += 16)
+    {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+        uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)), vcltq_u8(v, space));
+        //narrowing shift packs the 16 byte mask into 64 bits, four per byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+        if(mask != 0)
+            return p + (__builtin_ctzll(mask) >> 2);
+    }
+#endif
+    while(p < end && !is_special(*p))
+        p++;
+    return p;
+}
+
+static inline void put(std::string *out, const char *data, size_t length) { out->append(data, length); }
+static inline void put(arena_text *out, const char *data, size_t length) { arena_text_append(out, data, length); }
+
+template <typename Output>
+static void append_escaped(Output *out, const char *s, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *end = s + length;
+    put(out, "\"", 1);
+    while(true)
+    {
+        const char *p = find_special(s, end); //copy unescaped characters in one go
+        put(out, s, static_cast<size_t>(p - s));
+        if(p == end)
+            break;
+        s = p + 1;
+        unsigned char c = static_cast<unsigned char>(*p);
+        switch(c)
+        {
+            case '"': put(out, "\\\"", 2); break;
+            case '\\': put(out, "\\\\", 2); break;
+            case '\n': put(out, "\\n", 2); break;
+            case '\r': put(out, "\\r", 2); break;
+            case '\t': put(out, "\\t", 2); break;
+            default:
+            {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                put(out, escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    put(out, "\"", 1);
+}
+
+void json_append_string(std::string *out, const char *s)
+{
+    append_escaped(out, s, strlen(s));
+}
+
+void json_append_string(arena_text *out, const char *s)
+{
+    append_escaped(out, s, strlen(s));
+}
+
+void json_append_string(std::string *out, const char *s, size_t length)
+{
+    append_escaped(out, s, length);
+}
+
+void json_append_string(arena_text *out, const char *s, size_t length)
+{
+    append_escaped(out, s, length);
+}
+
+static void skip_whitespace(const char **p, const char *end)
+{
+    while(*p < end && (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n'))
+        (*p)++;
+}
+
+static bool read_hex4(const char *p, const char *end, unsigned *value)
+{
+    if(end - p < 4)
+        return false;
+    *value = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        char c = p[i];
+        unsigned digit;
+        if(c >= '0' && c <= '9')
+            digit = static_cast<unsigned>(c - '0');
+        else if(c >= 'a' && c <= 'f')
+            digit = static_cast<unsigned>(c - 'a' + 10);
+        else if(c >= 'A' && c <= 'F')
+            digit = static_cast<unsigned>(c - 'A' + 10);
+        else
+            return false;
+        *value = *value << 4 | digit;
+    }
+    return true;
+}
+
+static void append_utf8(std::string *out, unsigned code_point)
+{
+    if(code_point < 0x80)
+        out->push_back(static_cast<char>(code_point));
+    else if(code_point < 0x800)
+    {
+        out->push_back(static_cast<char>(0xc0 | code_point >> 6));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+    else if(code_point < 0x10000)
+    {
+        out->push_back(static_cast<char>(0xe0 | code_point >> 12));
+        out->push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3f)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+    else
+    {
+        out->push_back(static_cast<char>(0xf0 | code_point >> 18));
+        out->push_back(static_cast<char>(0x80 | (code_point >> 12 & 0x3f)));
+        out->push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3f)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+}
+
+/**
+ * Reads a quoted string starting at *p, unescaping it into 'out'.
+ */
+static bool read_string(const char **p, const char *end, std::string *out)
+{
+    const char *c = *p;
+    if(c == end || *c != '"')
+        return false;
+    c++;
+    out->clear();
+    while(c < end)
+    {
+        const char *run = c; //unescaped characters are copied in one go
+        c = find_special(c, end);
+        out->append(run, static_cast<size_t>(c - run));
+        if(c == end || static_cast<unsigned char>(*c) < 0x20)
+            return false;
+        if(*c == '"')
+        {
+            *p = c + 1;
+            return true;
+        }
+        if(++c == end)
+            return false;
+        switch(*c++)
+        {
+            case '"': out->push_back('"'); break;
+            case '\\': out->push_back('\\'); break;
+            case '/': out->push_back('/'); break;
+            case 'b': out->push_back('\b'); break;
+            case 'f': out->push_back('\f'); break;
+            case 'n': out->push_back('\n'); break;
+            case 'r': out->push_back('\r'); break;
+            case 't': out->push_back('\t'); break;
+            case 'u':
+            {
+                unsigned code_point;
+                if(!read_hex4(c, end, &code_point))
+                    return false;
+                c += 4;
+                if(code_point >= 0xd800 && code_point < 0xdc00) //high surrogate, the low one must follow
+                {
+                    unsigned low;
+                    if(end - c < 6 || c[0] != '\\' || c[1] != 'u' || !read_hex4(c + 2, end, &low) || low < 0xdc00 || low >= 0xe000)
+                        return false;
+                    c += 6;
+                    code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+                }
+                else if(code_point >= 0xdc00 && code_point < 0xe000)
+                    return false;
+                append_utf8(out, code_point);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/** Moves past a number in JSON's syntax, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?, false if there isn't one. */
+static bool skip_number(const char **p, const char *end)
+{
+    const char *c = *p;
+    if(c < end && *c == '-')
+        c++;
+    if(c == end || !is_digit(*c))
+        return false;
+    if(*c++ != '0')
+        while(c < end && is_digit(*c))
+            c++;
+    if(c < end && *c == '.')
+    {
+        if(++c == end || !is_digit(*c))
+            return false;
+        while(c < end && is_digit(*c))
+            c++;
+    }
+    if(c < end && (*c == 'e' || *c == 'E'))
+    {
+        if(++c < end && (*c == '+' || *c == '-'))
+            c++;
+        if(c == end || !is_digit(*c))
+            return false;
+        while(c < end && is_digit(*c))
+            c++;
+    }
+    *p = c;
+    return true;
+}
+
+/**
+ * Reads a number, true, false or null as its literal text.  Anything else,
+ * or one of them run on into more letters or digits, isn't JSON.
+ */
+static bool read_literal(const char **p, const char *end, std::string *out)
+{
+    static const char *words[] = { "true", "false", "null" };
+    const char *c = *p;
+    if(!skip_number(&c, end))
+    {
+        for(size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+        {
+            size_t length = strlen(words[i]);
+            if(static_cast<size_t>(end - c) >= length && memcmp(c, words[i], length) == 0)
+            {
+                c += length;
+                break;
+            }
+        }
+        if(c == *p)
+            return false;
+    }
+    if(c < end && (isalnum(static_cast<unsigned char>(*c)) || *c == '-' || *c == '+' || *c == '.'))
+        return false;
+    out->assign(*p, static_cast<size_t>(c - *p));
+    *p = c;
+    return true;
+}
+
+void json_reader_init(json_reader *reader, const char *text, size_t length)
+{
+    reader->p = text;
+    reader->end = text + length;
+    reader->state = JSON_EXPECT_VALUE;
+    reader->depth = 0;
+    reader->objects = 0;
+    reader->text.clear();
+}
+
+static enum JSON_Token reader_fail(json_reader *reader)
+{
+    reader->state = JSON_FAILED;
+    return JSON_ERROR;
+}
+
+/** What may come once a value (or a whole container) has been read. */
+static void reader_after_value(json_reader *reader)
+{
+    reader->state = reader->depth == 0 ? JSON_EXPECT_EOF : JSON_EXPECT_SEPARATOR;
+}
+
+static enum JSON_Token reader_open(json_reader *reader, bool object)
+{
+    if(reader->depth == JSON_MAX_DEPTH)
+        return reader_fail(reader);
+    reader->depth++;
+    reader->objects = reader->objects << 1 | (object ? 1 : 0);
+    reader->p++;
+    reader->state = object ? JSON_EXPECT_FIRST_NAME : JSON_EXPECT_FIRST_VALUE;
+    return object ? JSON_OBJECT_BEGIN : JSON_ARRAY_BEGIN;
+}
+
+static enum JSON_Token reader_close(json_reader *reader)
+{
+    bool object = (reader->objects & 1) != 0;
+    reader->depth--;
+    reader->objects >>= 1;
+    reader->p++;
+    reader_after_value(reader);
+    return object ? JSON_OBJECT_END : JSON_ARRAY_END;
+}
+
+enum JSON_Token json_reader_next(json_reader *reader)
+{
+    skip_whitespace(&reader->p, reader->end);
+    const char *end = reader->end;
+    if(reader->state == JSON_EXPECT_FIRST_NAME || reader->state == JSON_EXPECT_FIRST_VALUE)
+    {   //an empty container
+        if(reader->p < end && *reader->p == (reader->state == JSON_EXPECT_FIRST_NAME ? '}' : ']'))
+            return reader_close(reader);
+        reader->state = reader->state == JSON_EXPECT_FIRST_NAME ? JSON_EXPECT_NAME : JSON_EXPECT_VALUE;
+    }
+    switch(reader->state)
+    {
+        case JSON_FAILED:
+            return JSON_ERROR;
+        case JSON_EXPECT_EOF:
+            return reader->p == end ? JSON_END : reader_fail(reader);
+        case JSON_EXPECT_SEPARATOR:
+        {
+            if(reader->p == end)
+                return reader_fail(reader);
+            bool object = (reader->objects & 1) != 0;
+            char c = *reader->p;
+            if(c == (object ? '}' : ']'))
+                return reader_close(reader);
+            if(c != ',')
+                return reader_fail(reader);
+            reader->p++;
+            reader->state = object ? JSON_EXPECT_NAME : JSON_EXPECT_VALUE;
+            return json_reader_next(reader);
+        }
+        case JSON_EXPECT_NAME:
+            if(!read_string(&reader->p, end, &reader->text))
+                return reader_fail(reader);
+            skip_whitespace(&reader->p, end);
+            if(reader->p == end || *reader->p++ != ':')
+                return reader_fail(reader);
+            reader->state = JSON_EXPECT_VALUE;
+            return JSON_NAME;
+        case JSON_EXPECT_VALUE:
+            if(reader->p == end)
+                return reader_fail(reader);
+            if(*reader->p == '{' || *reader->p == '[')
+                return reader_open(reader, *reader->p == '{');
+            if(*reader->p == '"')
+            {
+                if(!read_string(&reader->p, end, &reader->text))
+                    return reader_fail(reader);
+                reader_after_value(reader);
+                return JSON_STRING;
+            }
+            if(!read_literal(&reader->p, end, &reader->text))
+                return reader_fail(reader);
+            reader_after_value(reader);
+            return JSON_LITERAL;
+        case JSON_EXPECT_FIRST_NAME:
+        case JSON_EXPECT_FIRST_VALUE:
+            break; //replaced above
+    }
+    return reader_fail(reader);
+}
+
+bool json_reader_skip(json_reader *reader, enum JSON_Token token)
+{
+    if(token == JSON_STRING || token == JSON_LITERAL)
+        return true;
+    if(token != JSON_OBJECT_BEGIN && token != JSON_ARRAY_BEGIN)
+        return false;
+    int depth = reader->depth - 1; //the container is closed when the reader is back out at this depth
+    while(reader->depth > depth)
+    {
+        token = json_reader_next(reader);
+        if(token == JSON_ERROR || token == JSON_END)
+            return false;
+    }
+    return true;
+}
+
+bool json_parse_object(const char *text, size_t length, std::vector<json_member> *members)
+{
+    json_reader reader;
+    json_reader_init(&reader, text, length);
+    members->clear();
+    if(json_reader_next(&reader) != JSON_OBJECT_BEGIN)
+        return false;
+    enum JSON_Token token;
+    while((token = json_reader_next(&reader)) == JSON_NAME)
+    {
+        json_member member;
+        member.name.swap(reader.text);
+        token = json_reader_next(&reader);
+        if(token != JSON_STRING && token != JSON_LITERAL) //nested objects and arrays aren't messages
+            return false;
+        member.value.swap(reader.text);
+        members->push_back(member);
+    }
+    return token == JSON_OBJECT_END && json_reader_next(&reader) == JSON_END;
+}
@@ -0,0 +1,95 @@
+/**
+ *  /file guwhiteboardwebposter/json.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "arena.h"
+
+#define JSON_MAX_DEPTH 32      ///< deeper documents are rejected
+
+enum JSON_Token
+{
+    JSON_OBJECT_BEGIN = 0,
+    JSON_OBJECT_END,
+    JSON_ARRAY_BEGIN,
+    JSON_ARRAY_END,
+    JSON_NAME,                  ///< member name, unescaped into 'text'
+    JSON_STRING,                ///< string value, unescaped into 'text'
+    JSON_LITERAL,               ///< number, true, false or null, its text is in 'text'
+    JSON_END,                   ///< the whole document has been read
+    JSON_ERROR                  ///< malformed or too deep, every later call returns this too
+};
+
+enum JSON_Reader_State
+{
+    JSON_EXPECT_VALUE = 0,
+    JSON_EXPECT_FIRST_VALUE,    ///< just after '[', so ']' is allowed
+    JSON_EXPECT_NAME,
+    JSON_EXPECT_FIRST_NAME,     ///< just after '{', so '}' is allowed
+    JSON_EXPECT_SEPARATOR,      ///< after a value, ',' or the end of its container
+    JSON_EXPECT_EOF,            ///< after the top level value, only whitespace is left
+    JSON_FAILED
+};
+
+/**
+ * Pull reader, hands a document out a token at a time without building a
+ * tree of it.  'text' keeps its storage, so reading the same sort of
+ * document again doesn't allocate.
+ */
+typedef struct json_reader_s
+{
+    const char *p;              ///< next character to read
+    const char *end;
+    enum JSON_Reader_State state;
+    int depth;                  ///< containers open
+    uint32_t objects;           ///< bit per open container, set for objects, bit 0 is the innermost
+    std::string text;           ///< name, string or literal of the last token
+} json_reader;
+
+/** one 'name: value' pair of a JSON object, both unescaped */
+typedef struct json_member_s
+{
+    std::string name;
+    std::string value;          ///< string contents, or the literal text of a number, true, false or null
+} json_member;
+
+/**
+ * Appends 's' as a quoted JSON string, escaping quotes, backslashes and control characters.
+ * Runs that need no escaping are found 16 bytes at a time with SSE2 or NEON where available.
+ */
+void json_append_string(std::string *out, const char *s);
+void json_append_string(arena_text *out, const char *s);
+void json_append_string(std::string *out, const char *s, size_t length);
+void json_append_string(arena_text *out, const char *s, size_t length);
+
+void json_reader_init(json_reader *reader, const char *text, size_t length);
+
+/** Reads the next token, checking that it may follow the ones before it. */
+enum JSON_Token json_reader_next(json_reader *reader);
+
+/**
+ * Reads past the rest of a value that started with 'token', the whole of
+ * it for an object or array.  False if the value is malformed or 'token'
+ * doesn't start one.
+ */
+bool json_reader_skip(json_reader *reader, enum JSON_Token token);
+
+/**
+ * Parses a flat JSON object such as {"Speech":"hello","Print":"hi"} into its
+ * members, in document order.  Nested objects and arrays are rejected.
+ */
+bool json_parse_object(const char *text, size_t length, std::vector<json_member> *members);
+
+#endif //JSON_H
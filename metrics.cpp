@@ -0,0 +1,245 @@
+/**
+ *  /file guwhiteboardwebposter/metrics.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <time.h>
+
+#include "metrics.h"
+#include "post_queue.h"
+#include "server.h"
+
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4"
+#define METRICS_PREFIX "guwhiteboardwebposter_"
+
+/** upper bounds of the histogram buckets, in nanoseconds */
+static const uint64_t bucket_bounds[METRICS_BUCKETS - 1] =
+{
+    50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000
+};
+
+static const char *route_names[NUM_METRICS_ROUTES] =
+{
+    "root", "message", "asset", "events", "snapshot", "raw", "history", "replay", "metrics", "other"
+};
+
+static const char *phase_names[NUM_METRICS_PHASES] =
+{
+    "queued", "parse", "whiteboard", "render", "write", "first_byte"
+};
+
+//every thread's block, only locked when a thread first records something and when scraped
+static std::mutex registry_lock;
+static std::vector<request_metrics *> registry;
+
+static thread_local request_metrics *local_metrics = nullptr;
+
+request_metrics *metrics_local(void)
+{
+    if(!local_metrics)
+    {
+        //workers run until the server stops, so their blocks are never freed
+        request_metrics *m = new request_metrics();
+        std::lock_guard<std::mutex> lock(registry_lock);
+        registry.push_back(m);
+        local_metrics = m;
+    }
+    return local_metrics;
+}
+
+uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void histogram_observe(histogram *h, uint64_t ns)
+{
+    int b = 0;
+    while(b < METRICS_BUCKETS - 1 && ns > bucket_bounds[b])
+        b++;
+    metrics_add(&h->buckets[b], 1);
+    metrics_add(&h->count, 1);
+    metrics_add(&h->sum_ns, ns);
+}
+
+void metrics_request(enum Metrics_Route route, enum HTTP_Verb verb, enum HTTP_Code code, uint64_t ns)
+{
+    request_metrics *m = metrics_local();
+    int v = verb < NUM_HTTP_VERBS ? verb : NUM_HTTP_VERBS;
+    if(code < NUM_HTTP_CODES)
+        metrics_add(&m->requests[route][v][code], 1);
+    histogram_observe(&m->latency[route], ns);
+}
+
+static uint64_t load(const std::atomic<uint64_t> &counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+/** A histogram summed over every thread. */
+typedef struct histogram_total_s
+{
+    uint64_t buckets[METRICS_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+} histogram_total;
+
+static void histogram_add(histogram_total *total, const histogram *h)
+{
+    for(int b = 0; b < METRICS_BUCKETS; b++)
+        total->buckets[b] += load(h->buckets[b]);
+    total->count += load(h->count);
+    total->sum_ns += load(h->sum_ns);
+}
+
+static void append(arena_text *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(arena_text *out, const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if(n > 0)
+        arena_text_append(out, line, static_cast<size_t>(n) < sizeof(line) ? static_cast<size_t>(n) : sizeof(line) - 1);
+}
+
+/** Appends a histogram's series, 'label' is nullptr for a histogram without one. */
+static void append_histogram(arena_text *out, const char *name, const char *label, const char *value, const histogram_total *h)
+{
+    char labels[64] = "";   //'label="value",' ahead of the buckets' 'le'
+    char series[64] = "";   //'{label="value"}' for the sum and count
+    if(label)
+    {
+        snprintf(labels, sizeof(labels), "%s=\"%s\",", label, value);
+        snprintf(series, sizeof(series), "{%s=\"%s\"}", label, value);
+    }
+    uint64_t cumulative = 0;
+    for(int b = 0; b < METRICS_BUCKETS; b++)
+    {
+        cumulative += h->buckets[b];
+        if(b < METRICS_BUCKETS - 1)
+            append(out, METRICS_PREFIX "%s_bucket{%sle=\"%g\"} %" PRIu64 "\n", name, labels, static_cast<double>(bucket_bounds[b]) / 1e9, cumulative);
+        else
+            append(out, METRICS_PREFIX "%s_bucket{%sle=\"+Inf\"} %" PRIu64 "\n", name, labels, cumulative);
+    }
+    append(out, METRICS_PREFIX "%s_sum%s %.9f\n", name, series, static_cast<double>(h->sum_ns) / 1e9);
+    append(out, METRICS_PREFIX "%s_count%s %" PRIu64 "\n", name, series, h->count);
+}
+
+void handle_metrics(struct connection_s *conn, struct header_info_s *header)
+{
+    //totals are kept in the arena, the registry is only held while they're summed
+    uint64_t *requests = static_cast<uint64_t *>(arena_alloc(&conn->scratch, sizeof(uint64_t) * NUM_METRICS_ROUTES * (NUM_HTTP_VERBS + 1) * NUM_HTTP_CODES));
+    histogram_total *latency = static_cast<histogram_total *>(arena_alloc(&conn->scratch, sizeof(histogram_total) * NUM_METRICS_ROUTES));
+    histogram_total *phases = static_cast<histogram_total *>(arena_alloc(&conn->scratch, sizeof(histogram_total) * NUM_METRICS_PHASES));
+    memset(requests, 0, sizeof(uint64_t) * NUM_METRICS_ROUTES * (NUM_HTTP_VERBS + 1) * NUM_HTTP_CODES);
+    memset(latency, 0, sizeof(histogram_total) * NUM_METRICS_ROUTES);
+    memset(phases, 0, sizeof(histogram_total) * NUM_METRICS_PHASES);
+    uint64_t compressed[4] = { 0, 0, 0, 0 };
+    size_t threads;
+    {
+        std::lock_guard<std::mutex> lock(registry_lock);
+        threads = registry.size();
+        for(size_t t = 0; t < registry.size(); t++)
+        {
+            const request_metrics *m = registry[t];
+            uint64_t *r = requests;
+            for(int route = 0; route < NUM_METRICS_ROUTES; route++)
+                for(int verb = 0; verb <= NUM_HTTP_VERBS; verb++)
+                    for(int code = 0; code < NUM_HTTP_CODES; code++)
+                        *r++ += load(m->requests[route][verb][code]);
+            for(int route = 0; route < NUM_METRICS_ROUTES; route++)
+                histogram_add(&latency[route], &m->latency[route]);
+            for(int phase = 0; phase < NUM_METRICS_PHASES; phase++)
+                histogram_add(&phases[phase], &m->phases[phase]);
+            compressed[0] += load(m->compressed_responses);
+            compressed[1] += load(m->compressed_bytes_in);
+            compressed[2] += load(m->compressed_bytes_out);
+            compressed[3] += load(m->compression_ns);
+        }
+    }
+
+    arena_text out;
+    arena_text_init(&out, &conn->scratch);
+    append(&out, "# HELP " METRICS_PREFIX "requests_total Requests answered, by route, verb and status.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "requests_total counter\n");
+    const uint64_t *r = requests;
+    for(int route = 0; route < NUM_METRICS_ROUTES; route++)
+        for(int verb = 0; verb <= NUM_HTTP_VERBS; verb++)
+            for(int code = 0; code < NUM_HTTP_CODES; code++, r++)
+                if(*r != 0)
+                    append(&out, METRICS_PREFIX "requests_total{route=\"%s\",verb=\"%s\",code=\"%.3s\"} %" PRIu64 "\n",
+                            route_names[route], verb < NUM_HTTP_VERBS ? HTTP_Verb_Strings[verb] : "other", HTTP_Code_Strings[code], *r);
+
+    append(&out, "# HELP " METRICS_PREFIX "request_duration_seconds Complete request received to response queued, by route.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "request_duration_seconds histogram\n");
+    for(int route = 0; route < NUM_METRICS_ROUTES; route++)
+        if(latency[route].count != 0)
+            append_histogram(&out, "request_duration_seconds", "route", route_names[route], &latency[route]);
+
+    append(&out, "# HELP " METRICS_PREFIX "phase_duration_seconds Time spent in each phase of answering requests.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "phase_duration_seconds histogram\n");
+    for(int phase = 0; phase < NUM_METRICS_PHASES; phase++)
+        append_histogram(&out, "phase_duration_seconds", "phase", phase_names[phase], &phases[phase]);
+
+    append(&out, "# HELP " METRICS_PREFIX "compressed_responses_total Responses sent gzip or deflate compressed.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "compressed_responses_total counter\n");
+    append(&out, METRICS_PREFIX "compressed_responses_total %" PRIu64 "\n", compressed[0]);
+    append(&out, "# HELP " METRICS_PREFIX "compression_input_bytes_total Body bytes before compression.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "compression_input_bytes_total counter\n");
+    append(&out, METRICS_PREFIX "compression_input_bytes_total %" PRIu64 "\n", compressed[1]);
+    append(&out, "# HELP " METRICS_PREFIX "compression_output_bytes_total Body bytes after compression.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "compression_output_bytes_total counter\n");
+    append(&out, METRICS_PREFIX "compression_output_bytes_total %" PRIu64 "\n", compressed[2]);
+    append(&out, "# HELP " METRICS_PREFIX "compression_seconds_total Time spent compressing.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "compression_seconds_total counter\n");
+    append(&out, METRICS_PREFIX "compression_seconds_total %.9f\n", static_cast<double>(compressed[3]) / 1e9);
+    append(&out, "# HELP " METRICS_PREFIX "worker_threads Worker threads that have recorded metrics.\n");
+    append(&out, "# TYPE " METRICS_PREFIX "worker_threads gauge\n");
+    append(&out, METRICS_PREFIX "worker_threads %zu\n", threads);
+
+    if(post_queue_enabled())
+    {
+        const post_queue_stats *queue = post_queue_get_stats();
+        append(&out, "# HELP " METRICS_PREFIX "post_queue_posts_total Posts accepted into the post queue.\n");
+        append(&out, "# TYPE " METRICS_PREFIX "post_queue_posts_total counter\n");
+        append(&out, METRICS_PREFIX "post_queue_posts_total %" PRIu64 "\n", load(queue->queued));
+        append(&out, "# HELP " METRICS_PREFIX "post_queue_coalesced_total Queued posts replaced by a later post to the same type before being flushed.\n");
+        append(&out, "# TYPE " METRICS_PREFIX "post_queue_coalesced_total counter\n");
+        append(&out, METRICS_PREFIX "post_queue_coalesced_total %" PRIu64 "\n", load(queue->coalesced));
+        append(&out, "# HELP " METRICS_PREFIX "post_queue_flushed_total Queued posts written to the whiteboard.\n");
+        append(&out, "# TYPE " METRICS_PREFIX "post_queue_flushed_total counter\n");
+        append(&out, METRICS_PREFIX "post_queue_flushed_total %" PRIu64 "\n", load(queue->flushed));
+        append(&out, "# HELP " METRICS_PREFIX "post_queue_rejected_total Flushed posts the type's parser refused.\n");
+        append(&out, "# TYPE " METRICS_PREFIX "post_queue_rejected_total counter\n");
+        append(&out, METRICS_PREFIX "post_queue_rejected_total %" PRIu64 "\n", load(queue->rejected));
+        append(&out, "# HELP " METRICS_PREFIX "post_queue_flushed_sequence Every post up to this sequence number has been flushed or superseded.\n");
+        append(&out, "# TYPE " METRICS_PREFIX "post_queue_flushed_sequence gauge\n");
+        append(&out, METRICS_PREFIX "post_queue_flushed_sequence %" PRIu64 "\n", load(queue->flushed_sequence));
+        histogram_total flushes;
+        memset(&flushes, 0, sizeof(flushes));
+        histogram_add(&flushes, &queue->flushes);
+        append(&out, "# HELP " METRICS_PREFIX "post_queue_flush_duration_seconds Time taken to post each batch to the whiteboard.\n");
+        append(&out, "# TYPE " METRICS_PREFIX "post_queue_flush_duration_seconds histogram\n");
+        append_histogram(&out, "post_queue_flush_duration_seconds", nullptr, nullptr, &flushes);
+    }
+
+    body_part part = { out.data, out.length, false };
+    generate_response_parts(conn, header->version, _200_OK, METRICS_CONTENT_TYPE, &part, 1, "Cache-Control: no-cache\r\n");
+}
@@ -0,0 +1,106 @@
+/**
+ *  /file guwhiteboardwebposter/metrics.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include "http_parser.h"
+
+#define METRICS_BUCKETS 15      ///< histogram buckets, 50us to 1s and then +Inf
+
+/** what a request was for, the 'route' label */
+enum Metrics_Route
+{
+    ROUTE_ROOT = 0,             ///< GET / listings, batch posts
+    ROUTE_MESSAGE,              ///< /$(msg)
+    ROUTE_ASSET,                ///< static scripts and styles
+    ROUTE_EVENTS,               ///< /events
+    ROUTE_SNAPSHOT,             ///< /snapshot
+    ROUTE_RAW,                  ///< /raw/$(msg)
+    ROUTE_HISTORY,              ///< /history/$(msg)
+    ROUTE_REPLAY,               ///< /replay
+    ROUTE_METRICS,              ///< /metrics
+    ROUTE_OTHER,                ///< anything else, including requests rejected before routing
+    NUM_METRICS_ROUTES
+};
+
+/** where the time goes while answering a request, the 'phase' label */
+enum Metrics_Phase
+{
+    PHASE_QUEUED = 0,           ///< kernel receive timestamp (SO_TIMESTAMP) to the header being parsed
+    PHASE_PARSE,                ///< parsing the header
+    PHASE_WHITEBOARD,           ///< getters, posts and slot copies
+    PHASE_RENDER,               ///< the rest of the handler, building the response
+    PHASE_WRITE,                ///< queued response to the last byte written
+    PHASE_FIRST_BYTE,           ///< accept() to the connection's first response byte
+    NUM_METRICS_PHASES
+};
+
+/** cumulative latency distribution */
+typedef struct histogram_s
+{
+    std::atomic<uint64_t> buckets[METRICS_BUCKETS]; ///< observations in each bucket, not cumulative
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+} histogram;
+
+/**
+ * Counters kept by each worker thread.  Only the owning thread writes
+ * them, with plain relaxed stores, and /metrics sums every thread's
+ * block, so recording doesn't lock or contend.
+ */
+typedef struct request_metrics_s
+{
+    std::atomic<uint64_t> compressed_responses;
+    std::atomic<uint64_t> compressed_bytes_in;      ///< body bytes before compression
+    std::atomic<uint64_t> compressed_bytes_out;     ///< and after
+    std::atomic<uint64_t> compression_ns;           ///< time spent compressing
+    std::atomic<uint64_t> requests[NUM_METRICS_ROUTES][NUM_HTTP_VERBS + 1][NUM_HTTP_CODES]; ///< last verb is 'other'
+    histogram latency[NUM_METRICS_ROUTES];          ///< complete request received to response queued, by route
+    histogram phases[NUM_METRICS_PHASES];
+    uint64_t whiteboard_ns;                         ///< running total behind PHASE_WHITEBOARD, owner only
+} request_metrics;
+
+/** The calling thread's counters, registered for /metrics the first time. */
+request_metrics *metrics_local(void);
+
+/** Monotonic clock in nanoseconds. */
+uint64_t monotonic_ns(void);
+
+/** Adds to a counter only the calling thread writes, without a locked instruction. */
+inline void metrics_add(std::atomic<uint64_t> *counter, uint64_t n)
+{
+    counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/** Records an observation. */
+void histogram_observe(histogram *h, uint64_t ns);
+
+/** Counts an answered request and how long it took. */
+void metrics_request(enum Metrics_Route route, enum HTTP_Verb verb, enum HTTP_Code code, uint64_t ns);
+
+/** Records how long a phase of a request took. */
+inline void metrics_phase(enum Metrics_Phase phase, uint64_t ns)
+{
+    histogram_observe(&metrics_local()->phases[phase], ns);
+}
+
+/** Adds the time since 'start' to the thread's whiteboard total. */
+inline void metrics_whiteboard(uint64_t start)
+{
+    metrics_local()->whiteboard_ns += monotonic_ns() - start;
+}
+
+/** GET /metrics, every worker's counters in the Prometheus text format. */
+void handle_metrics(struct connection_s *conn, struct header_info_s *header);
+
+#endif //METRICS_H
@@ -0,0 +1,91 @@
+/**
+ *  /file guwhiteboardwebposter/name_index.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "name_index.h"
+
+#define NAME_INDEX_SEEDS 1024   ///< seeds tried at one table size before doubling it
+#define NAME_INDEX_MAX_GROWTH 8 ///< doublings past the starting size before giving up
+
+//FNV-1a, starting from the seed instead of the usual offset basis
+static inline uint32_t name_hash(const char *name, size_t length, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for(size_t i = 0; i < length; i++)
+    {
+        h ^= static_cast<unsigned char>(name[i]);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+static bool fill_slots(name_index *index, int count, const std::vector<bool> &repeated)
+{
+    std::fill(index->slots.begin(), index->slots.end(), -1);
+    for(int i = 0; i < count; i++)
+    {
+        if(repeated[static_cast<size_t>(i)])
+            continue;
+        size_t slot = name_hash(index->names[i], index->lengths[static_cast<size_t>(i)], index->seed) & index->mask;
+        if(index->slots[slot] != -1)
+            return false;
+        index->slots[slot] = i;
+    }
+    return true;
+}
+
+void name_index_build(name_index *index, const char * const *names, int count)
+{
+    index->names = names;
+    index->lengths.resize(static_cast<size_t>(count));
+    for(int i = 0; i < count; i++)
+        index->lengths[static_cast<size_t>(i)] = strlen(names[i]);
+
+    //equal names would always collide, only the first is indexed, as the strncmp scan found it first
+    std::vector<bool> repeated(static_cast<size_t>(count), false);
+    for(int i = 0; i < count; i++)
+    {
+        size_t length = index->lengths[static_cast<size_t>(i)];
+        for(int j = 0; j < i; j++)
+        {
+            if(!repeated[static_cast<size_t>(j)] && index->lengths[static_cast<size_t>(j)] == length && memcmp(names[j], names[i], length) == 0)
+            {
+                fprintf(stderr, "Name '%s' is at %d and %d, only %d is found\n", names[i], j, i, j);
+                repeated[static_cast<size_t>(i)] = true;
+                break;
+            }
+        }
+    }
+
+    //start at twice as many slots as names, which usually finds a seed in a few tries
+    size_t size = 2;
+    while(size < 2 * static_cast<size_t>(count))
+        size <<= 1;
+    for(int growth = 0; growth <= NAME_INDEX_MAX_GROWTH; growth++, size <<= 1)
+    {
+        index->slots.resize(size);
+        index->mask = size - 1;
+        for(index->seed = 0; index->seed < NAME_INDEX_SEEDS; index->seed++)
+            if(fill_slots(index, count, repeated))
+                return;
+    }
+    fprintf(stderr, "No collision free seed for %d names in up to %zu slots\n", count, size >> 1);
+    abort();
+}
+
+int name_index_find(const name_index *index, const char *name, size_t length)
+{
+    int i = index->slots[name_hash(name, length, index->seed) & index->mask];
+    if(i == -1 || index->lengths[static_cast<size_t>(i)] != length || memcmp(index->names[i], name, length) != 0)
+        return -1;
+    return i;
+}
@@ -0,0 +1,42 @@
+/**
+ *  /file guwhiteboardwebposter/name_index.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * Perfect hash from a fixed set of names to their position in the array
+ * they came from.  The seed and table size are searched for once, when the
+ * index is built, so that every name lands in a slot of its own; a lookup
+ * is then one hash, one slot and one memcmp, whatever the number of names.
+ */
+typedef struct name_index_s
+{
+    const char * const *names;  ///< the array that was indexed, not copied
+    std::vector<size_t> lengths; ///< strlen() of each name
+    std::vector<int> slots;     ///< position of the name hashed to each slot, -1 for none
+    size_t mask;                ///< slots.size() - 1, a power of two
+    uint32_t seed;              ///< hash seed that gives no collisions
+} name_index;
+
+/**
+ * Builds an index over 'count' names.  The array must outlive the index.
+ * A name that appears more than once is found at its first position.
+ * Aborts if no seed separates the names within a bounded table size.
+ */
+void name_index_build(name_index *index, const char * const *names, int count);
+
+/** Position of the name, or -1 if it isn't one of them. */
+int name_index_find(const name_index *index, const char *name, size_t length);
+
+#endif //NAME_INDEX_H
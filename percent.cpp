@@ -0,0 +1,128 @@
+/**
+ *  /file guwhiteboardwebposter/percent.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PERCENT_NEON
+#endif
+
+#include "percent.h"
+
+/** value of each hex digit, -1 for anything else */
+static const signed char hex_values[256] =
+{
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/**
+ * Decodes the '+' or escape at *p, returns false if it's malformed.
+ */
+static inline bool decode_special(const char **p, const char *end, char **o)
+{
+    const char *c = *p;
+    if(*c == '+')
+    {
+        *(*o)++ = ' ';
+        *p = c + 1;
+        return true;
+    }
+    if(end - c < 3)
+        return false;
+    int high = hex_values[static_cast<unsigned char>(c[1])];
+    int low = hex_values[static_cast<unsigned char>(c[2])];
+    if((high | low) < 0)
+        return false;
+    *(*o)++ = static_cast<char>(high << 4 | low);
+    *p = c + 3;
+    return true;
+}
+
+int percent_decode(const char *s, size_t length, char *out, size_t size)
+{
+    const char *p = s;
+    const char *end = s + length;
+    char *o = out;
+    char *out_end = out + size;
+#if defined(__SSE2__)
+    const __m128i percent = _mm_set1_epi8('%');
+    const __m128i plus = _mm_set1_epi8('+');
+    while(end - p >= 16 && out_end - o >= 16)
+    {
+        //the 16 bytes are stored whatever they hold, then only the part before the first escape is kept
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(o), v);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, percent), _mm_cmpeq_epi8(v, plus))));
+        if(mask == 0)
+        {
+            p += 16;
+            o += 16;
+            continue;
+        }
+        unsigned n = static_cast<unsigned>(__builtin_ctz(mask));
+        p += n;
+        o += n;
+        if(!decode_special(&p, end, &o))
+            return -1;
+    }
+#elif defined(PERCENT_NEON)
+    const uint8x16_t percent = vdupq_n_u8('%');
+    const uint8x16_t plus = vdupq_n_u8('+');
+    while(end - p >= 16 && out_end - o >= 16)
+    {
+        //the 16 bytes are stored whatever they hold, then only the part before the first escape is kept
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+        vst1q_u8(reinterpret_cast<uint8_t *>(o), v);
+        uint8x16_t special = vorrq_u8(vceqq_u8(v, percent), vceqq_u8(v, plus));
+        //narrowing shift packs the 16 byte mask into 64 bits, four per byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+        if(mask == 0)
+        {
+            p += 16;
+            o += 16;
+            continue;
+        }
+        unsigned n = static_cast<unsigned>(__builtin_ctzll(mask) >> 2);
+        p += n;
+        o += n;
+        if(!decode_special(&p, end, &o))
+            return -1;
+    }
+#endif
+    while(p < end)
+    {
+        if(o == out_end)
+            return -1;
+        if(*p != '%' && *p != '+')
+            *o++ = *p++;
+        else if(!decode_special(&p, end, &o))
+            return -1;
+    }
+    if(o == out_end)
+        return -1;
+    *o = '\0';
+    return static_cast<int>(o - out);
+}
@@ -0,0 +1,27 @@
+/**
+ *  /file guwhiteboardwebposter/percent.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef PERCENT_H
+#define PERCENT_H
+
+#include <cstddef>
+
+/**
+ * Decodes 'length' bytes of URL/form encoding, '+' for a space and %XX
+ * escapes, into 'out' and NUL terminates it.  Stretches without either are
+ * found and copied 16 bytes at a time with SSE2 or NEON where available,
+ * and escapes are decoded with a table instead of sscanf().
+ *
+ * Returns the decoded length, without the NUL, or -1 if an escape is
+ * malformed or the result doesn't fit in 'size' bytes.  The result is
+ * never longer than the input, so 'length + 1' bytes is always enough.
+ * 'out' must not overlap 's'.
+ */
+int percent_decode(const char *s, size_t length, char *out, size_t size);
+
+#endif //PERCENT_H
@@ -0,0 +1,160 @@
+/**
+ *  /file guwhiteboardwebposter/post_queue.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "post_queue.h"
+
+/** the latest value queued for a type */
+typedef struct queued_post_s
+{
+    std::string value;
+    bool pending;                       ///< queued and not flushed yet
+} queued_post;
+
+typedef struct post_queue_s
+{
+    std::mutex lock;
+    std::condition_variable wake;       ///< something was queued, or the queue is stopping
+    std::vector<queued_post> slots;     ///< by type
+    std::vector<int> order;             ///< types with a pending post, in the order they were first queued
+    uint64_t sequence;                  ///< last sequence number handed out
+    bool stopping;
+    uint64_t interval_ns;               ///< shortest time between the starts of two flushes
+    gu_simple_whiteboard_descriptor *wbd; ///< the flush thread's own descriptor
+    std::thread *flusher;
+} post_queue;
+
+//allocated once for the life of the server, every worker pushes to it
+static post_queue *queue = nullptr;
+static std::atomic<bool> enabled(false);
+static post_queue_stats stats;
+
+/**
+ * Takes everything queued, posts it with the lock released, then waits out
+ * the rest of the interval so a burst of posts is written as one batch.
+ */
+static void flush_run(void)
+{
+    std::vector<int> types;
+    std::vector<std::string> values;
+    std::unique_lock<std::mutex> lock(queue->lock);
+    while(true)
+    {
+        queue->wake.wait(lock, [] { return queue->stopping || !queue->order.empty(); });
+        if(queue->order.empty())
+            break; //stopping, and everything has been posted
+
+        types.swap(queue->order);
+        uint64_t batch = queue->sequence; //every post up to here is in this batch or was superseded
+        if(values.size() < types.size())
+            values.resize(types.size());
+        for(size_t i = 0; i < types.size(); i++)
+        {
+            queued_post *post = &queue->slots[static_cast<size_t>(types[i])];
+            values[i].swap(post->value); //both keep their storage for the next time round
+            post->pending = false;
+        }
+        lock.unlock();
+
+        uint64_t start = monotonic_ns();
+        for(size_t i = 0; i < types.size(); i++)
+        {
+            //posted directly rather than through wb_post(), this thread isn't a worker with request metrics
+            if(!guWhiteboard::postmsg(static_cast<WBTypes>(types[i]), values[i], queue->wbd))
+                stats.rejected.fetch_add(1, std::memory_order_relaxed);
+        }
+        uint64_t elapsed = monotonic_ns() - start;
+        stats.flushed.fetch_add(types.size(), std::memory_order_relaxed);
+        stats.flushed_sequence.store(batch, std::memory_order_relaxed);
+        histogram_observe(&stats.flushes, elapsed);
+        types.clear();
+
+        lock.lock();
+        if(elapsed < queue->interval_ns)
+            queue->wake.wait_for(lock, std::chrono::nanoseconds(queue->interval_ns - elapsed), [] { return queue->stopping; });
+    }
+}
+
+bool post_queue_start(const char *wbname, int rate)
+{
+    queue = new post_queue();
+    queue->slots.resize(GSW_NUM_TYPES_DEFINED);
+    for(size_t i = 0; i < queue->slots.size(); i++)
+        queue->slots[i].pending = false;
+    queue->sequence = 0;
+    queue->stopping = false;
+    queue->interval_ns = 1000000000ULL / static_cast<uint64_t>(rate > 0 ? rate : 1);
+    queue->wbd = gsw_new_whiteboard(wbname);
+    if(!queue->wbd)
+    {
+        delete queue;
+        queue = nullptr;
+        return false;
+    }
+    queue->flusher = new std::thread(flush_run);
+    enabled.store(true);
+    return true;
+}
+
+void post_queue_stop(void)
+{
+    if(!queue || !queue->flusher)
+        return;
+    enabled.store(false);
+    {
+        std::lock_guard<std::mutex> lock(queue->lock);
+        queue->stopping = true;
+    }
+    queue->wake.notify_one();
+    queue->flusher->join();
+    delete queue->flusher;
+    queue->flusher = nullptr;
+    gsw_free_whiteboard(queue->wbd);
+}
+
+bool post_queue_enabled(void)
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t post_queue_push(int type, const std::string &value)
+{
+    bool first;
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(queue->lock);
+        queued_post *post = &queue->slots[static_cast<size_t>(type)];
+        first = queue->order.empty();
+        if(post->pending)
+            stats.coalesced.fetch_add(1, std::memory_order_relaxed); //last writer wins
+        else
+        {
+            post->pending = true;
+            queue->order.push_back(type);
+        }
+        post->value.assign(value);
+        sequence = ++queue->sequence;
+    }
+    stats.queued.fetch_add(1, std::memory_order_relaxed);
+    if(first)
+        queue->wake.notify_one(); //only cuts the flusher's wait short if it's idle, not between flushes
+    return sequence;
+}
+
+const post_queue_stats *post_queue_get_stats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,53 @@
+/**
+ *  /file guwhiteboardwebposter/post_queue.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef POST_QUEUE_H
+#define POST_QUEUE_H
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+
+#include "metrics.h"
+
+/** counters for /metrics, written by the workers and the flush thread */
+typedef struct post_queue_stats_s
+{
+    std::atomic<uint64_t> queued;       ///< posts accepted into the queue
+    std::atomic<uint64_t> coalesced;    ///< replaced by a later post to the same type before being flushed
+    std::atomic<uint64_t> flushed;      ///< posted to the whiteboard
+    std::atomic<uint64_t> rejected;     ///< flushed, but refused by the type's parser
+    std::atomic<uint64_t> flushed_sequence; ///< every post up to this sequence number has reached the whiteboard or been superseded
+    histogram flushes;                  ///< time taken to post each batch, flush thread only
+} post_queue_stats;
+
+/**
+ * Starts the flush thread, on its own descriptor for 'wbname'.  From then on
+ * POSTs to a message are queued instead of posted while the request is
+ * handled, and the queue is posted to the whiteboard at most 'rate' times a
+ * second.  Only the latest value queued for a type is kept.
+ */
+bool post_queue_start(const char *wbname, int rate);
+
+/** Posts whatever is still queued and stops the flush thread. */
+void post_queue_stop(void);
+
+/** Whether posts should go through the queue. */
+bool post_queue_enabled(void);
+
+/**
+ * Queues 'value' for 'type', replacing anything queued for it that hasn't
+ * been flushed yet.  Returns the post's sequence number, which increases
+ * across every type.
+ */
+uint64_t post_queue_push(int type, const std::string &value);
+
+const post_queue_stats *post_queue_get_stats(void);
+
+#endif //POST_QUEUE_H
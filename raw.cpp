@@ -0,0 +1,93 @@
+/**
+ *  /file guwhiteboardwebposter/raw.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+
+#include "gusimplewhiteboard.h"
+
+#include "compress.h"
+#include "raw.h"
+#include "server.h"
+#include "wb_types.h"
+
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+    for(int i = 0; i < bytes; i++)
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static void encode_header(const raw_header *h, uint8_t *bytes)
+{
+    put_le(bytes, h->type, 4);
+    put_le(bytes + 4, h->size, 4);
+    put_le(bytes + 8, h->event_counter, 2);
+    put_le(bytes + 10, 0, 2);
+}
+
+static void raw_response(struct connection_s *conn, struct header_info_s *header, enum HTTP_Code code, const char *headers)
+{
+    //a 304 varies with Accept-Encoding like the 200 it stands in for
+    generate_response_parts(conn, header->version, code, Content_Type_Strings[Application_octet_stream], nullptr, 0, headers, code == _304_Not_Modified);
+}
+
+static void handle_get_raw(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, int type)
+{
+    char etag[WB_ETAG_SIZE];
+    wb_type_etag(wbd, type, Application_octet_stream, compress_negotiated(header->accept_encoding), etag, sizeof(etag));
+    char headers[WB_ETAG_SIZE + 48];
+    snprintf(headers, sizeof(headers), "ETag: %s\r\nCache-Control: no-cache\r\n", etag);
+    const http_string *if_none_match = http_find_field(&header->request, "If-None-Match");
+    if(if_none_match && http_etag_matches(*if_none_match, etag))
+    {
+        raw_response(conn, header, _304_Not_Modified, headers);
+        return;
+    }
+
+    //one copy out of the slot under the lock, one into the write queue
+    gu_simple_message *message = static_cast<gu_simple_message *>(arena_alloc(&conn->scratch, sizeof(gu_simple_message)));
+    raw_header h;
+    h.type = static_cast<uint32_t>(type);
+    h.size = sizeof(gu_simple_message);
+    wb_snapshot(wbd, &type, 1, message, &h.event_counter);
+    uint8_t prefix[RAW_HEADER_SIZE];
+    encode_header(&h, prefix);
+    body_part body[2] =
+    {
+        { reinterpret_cast<const char *>(prefix), sizeof(prefix), false },
+        { reinterpret_cast<const char *>(message), sizeof(gu_simple_message), false }
+    };
+    generate_response_parts(conn, header->version, _200_OK, Content_Type_Strings[Application_octet_stream], body, 2, headers);
+}
+
+void handle_raw(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body)
+{
+    http_string path = http_url_path(header->url);
+    int type = wb_find_type(path.data + 5, path.length - 5); //after '/raw/'
+    if(type == -1)
+    {
+        raw_response(conn, header, _404_Not_Found, nullptr);
+        return;
+    }
+
+    if(header->verb == HTTP_GET)
+        handle_get_raw(conn, wbd, header, type);
+    else if(header->verb == HTTP_PUT)
+    {
+        if(header->content_length < 0)
+            raw_response(conn, header, _411_Length_Required, nullptr);
+        else if(static_cast<size_t>(header->content_length) > sizeof(gu_simple_message))
+            raw_response(conn, header, _400_Bad_Request, nullptr);
+        else
+        {
+            wb_write_slot(wbd, type, body, static_cast<size_t>(header->content_length));
+            raw_response(conn, header, _204_No_Content, nullptr);
+        }
+    }
+    else
+        raw_response(conn, header, _501_Not_Implemented, nullptr);
+}
@@ -0,0 +1,42 @@
+/**
+ *  /file guwhiteboardwebposter/raw.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef RAW_H
+#define RAW_H
+
+#include <stdint.h>
+
+#include "guwhiteboardwebposter.h"
+
+#define RAW_HEADER_SIZE 12  ///< bytes before the message in a GET /raw/<type> response
+
+/**
+ * What GET /raw/<type> sends before the slot's bytes, every field little
+ * endian so clients can read it the same way on any machine:
+ *
+ *     offset 0   uint32  type index
+ *     offset 4   uint32  size of the message that follows
+ *     offset 8   uint16  event counter the slot was copied at
+ *     offset 10  uint16  reserved, 0
+ */
+typedef struct raw_header_s
+{
+    uint32_t type;
+    uint32_t size;
+    uint16_t event_counter;
+} raw_header;
+
+/**
+ * /raw/<type> reads or writes a type's current generation slot as bytes,
+ * without going through its string getter or parser.
+ *     GET answers 'application/octet-stream', a raw_header then the message.
+ *     PUT takes the message bytes (at most the slot size) and copies them in.
+ */
+void handle_raw(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header, char *body);
+
+#endif //RAW_H
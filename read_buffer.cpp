@@ -0,0 +1,138 @@
+/**
+ *  /file guwhiteboardwebposter/read_buffer.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "read_buffer.h"
+
+void read_buffer_init(read_buffer *rb, size_t max_size)
+{
+    rb->data = nullptr;
+    rb->capacity = 0;
+    rb->max_size = max_size;
+    rb->start = 0;
+    rb->end = 0;
+    rb->scanned = 0;
+    rb->received.tv_sec = 0;
+    rb->received.tv_usec = 0;
+}
+
+void read_buffer_free(read_buffer *rb)
+{
+    free(rb->data);
+    read_buffer_init(rb, rb->max_size);
+}
+
+/**
+ * Makes room after 'end', preferring to slide the unconsumed bytes to the
+ * front over allocating.  Returns false if the buffer is full at max_size.
+ */
+static bool read_buffer_reserve(read_buffer *rb)
+{
+    if(rb->start == rb->end)
+    {
+        rb->start = rb->end = 0;
+        rb->scanned = 0;
+    }
+    if(rb->end < rb->capacity)
+        return true;
+    if(rb->start > 0)
+    {
+        memmove(rb->data, rb->data + rb->start, rb->end - rb->start);
+        rb->end -= rb->start;
+        rb->start = 0;
+        return true;
+    }
+    if(rb->capacity >= rb->max_size)
+        return false;
+    size_t capacity = rb->capacity == 0 ? READ_BUFFER_INITIAL_SIZE : rb->capacity * 2;
+    if(capacity > rb->max_size)
+        capacity = rb->max_size;
+    char *data = static_cast<char *>(realloc(rb->data, capacity));
+    if(!data)
+        return false;
+    rb->data = data;
+    rb->capacity = capacity;
+    return true;
+}
+
+enum Read_Status read_buffer_fill(read_buffer *rb, int fd)
+{
+    if(!read_buffer_reserve(rb))
+        return READ_AGAIN;
+    bool empty = rb->start == rb->end;
+    while(true)
+    {
+        struct iovec iov;
+        iov.iov_base = rb->data + rb->end;
+        iov.iov_len = rb->capacity - rb->end;
+        union
+        {
+            char buf[CMSG_SPACE(sizeof(struct timeval))];
+            struct cmsghdr align;
+        } control;
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = empty ? control.buf : nullptr; //only the first bytes of a request are timed
+        msg.msg_controllen = empty ? sizeof(control.buf) : 0;
+        ssize_t r = recvmsg(fd, &msg, 0);
+        if(r > 0)
+        {
+            rb->end += static_cast<size_t>(r);
+            if(empty)
+            {
+                rb->received.tv_sec = 0;
+                rb->received.tv_usec = 0;
+                for(struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c))
+                    if(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMP)
+                        memcpy(&rb->received, CMSG_DATA(c), sizeof(rb->received));
+            }
+            return READ_OK;
+        }
+        if(r == 0)
+            return READ_CLOSED;
+        if(errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? READ_AGAIN : READ_ERROR;
+    }
+}
+
+size_t read_buffer_find_header_end(read_buffer *rb)
+{
+    const char *base = rb->data + rb->start;
+    size_t length = rb->end - rb->start;
+    //back up far enough to catch a terminator split across two reads
+    size_t i = rb->scanned > 3 ? rb->scanned - 3 : 0;
+    while(i + 4 <= length)
+    {
+        const char *cr = static_cast<const char *>(memchr(base + i, '\r', length - i - 3));
+        if(!cr)
+            break;
+        i = static_cast<size_t>(cr - base);
+        if(cr[1] == '\n' && cr[2] == '\r' && cr[3] == '\n')
+            return i + 4;
+        i++;
+    }
+    rb->scanned = length;
+    return 0;
+}
+
+void read_buffer_consume(read_buffer *rb, size_t n)
+{
+    rb->start += n;
+    rb->scanned = 0;
+    if(rb->start >= rb->end)
+        rb->start = rb->end = 0;
+}
@@ -0,0 +1,71 @@
+/**
+ *  /file guwhiteboardwebposter/read_buffer.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef READ_BUFFER_H
+#define READ_BUFFER_H
+
+#include <cstddef>
+
+#include <sys/time.h>
+#include <sys/types.h>
+
+#define READ_BUFFER_INITIAL_SIZE 4096   ///< first allocation for a connection's input
+
+/**
+ * Per connection input buffer.
+ *
+ * Bytes are received straight into the free space after 'end' with one
+ * large recv() and consumed from 'start', so whatever follows a request
+ * (its body, or the next pipelined request) stays where it is.  The header
+ * terminator search remembers how far it got, so each byte is only looked
+ * at once no matter how many reads a header arrives in.
+ */
+typedef struct read_buffer_s
+{
+    char *data;         ///< storage
+    size_t capacity;    ///< usable size of data
+    size_t max_size;    ///< capacity is never grown past this
+    size_t start;       ///< first unconsumed byte
+    size_t end;         ///< one past the last received byte
+    size_t scanned;     ///< bytes after start already searched for the header terminator
+    struct timeval received; ///< kernel receive time (SO_TIMESTAMP) of the oldest unconsumed bytes, zero if unknown
+} read_buffer;
+
+/** result of read_buffer_fill() */
+enum Read_Status
+{
+    READ_OK = 0,        ///< got some bytes
+    READ_AGAIN,         ///< nothing available right now, or the buffer is full
+    READ_CLOSED,        ///< peer has shut down its side
+    READ_ERROR          ///< socket error, errno is set
+};
+
+void read_buffer_init(read_buffer *rb, size_t max_size);
+void read_buffer_free(read_buffer *rb);
+
+/**
+ * Receives as much as fits into the free space, compacting or growing the
+ * buffer first if needed.  Picks up the kernel's receive timestamp when
+ * the buffer was empty, if the socket has SO_TIMESTAMP turned on.
+ */
+enum Read_Status read_buffer_fill(read_buffer *rb, int fd);
+
+/**
+ * Looks for the blank line that ends a request header, continuing from where the previous call stopped.
+ * Returns the header length including the terminator, or 0 if it hasn't arrived yet.
+ */
+size_t read_buffer_find_header_end(read_buffer *rb);
+
+/** Drops n bytes from the front and restarts the header search. */
+void read_buffer_consume(read_buffer *rb, size_t n);
+
+/** Unconsumed bytes. */
+inline const char *read_buffer_data(const read_buffer *rb) { return rb->data + rb->start; }
+inline size_t read_buffer_length(const read_buffer *rb) { return rb->end - rb->start; }
+
+#endif //READ_BUFFER_H
@@ -0,0 +1,493 @@
+/**
+ *  /file guwhiteboardwebposter/recording.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gusimplewhiteboard.h"
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "metrics.h"
+#include "recording.h"
+#include "wb_types.h"
+
+static void put_le(char *p, uint64_t value, int bytes)
+{
+    for(int i = 0; i < bytes; i++)
+        p[i] = static_cast<char>(value >> (8 * i));
+}
+
+static uint64_t get_le(const char *p, int bytes)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < bytes; i++)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return value;
+}
+
+static size_t padded(size_t length)
+{
+    return (length + 7) & ~static_cast<size_t>(7);
+}
+
+static bool write_all(int fd, const char *data, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t n = write(fd, data, length);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool read_at(int fd, char *data, size_t length, uint64_t offset)
+{
+    while(length > 0)
+    {
+        ssize_t n = pread(fd, data, length, static_cast<off_t>(offset));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        data += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+/**
+ * Grows the file by a segment and maps it.  The blocks are allocated up front
+ * where that's possible, so a full disk is an error here rather than a SIGBUS
+ * on some later write into the mapping.
+ */
+static bool map_write_segment(recording_writer *writer, uint64_t offset)
+{
+#ifdef __linux__
+    if(posix_fallocate(writer->fd, static_cast<off_t>(offset), RECORDING_SEGMENT_SIZE) != 0)
+        return false;
+#else
+    if(ftruncate(writer->fd, static_cast<off_t>(offset + RECORDING_SEGMENT_SIZE)) != 0)
+        return false;
+#endif
+    void *p = mmap(nullptr, RECORDING_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, static_cast<off_t>(offset));
+    if(p == MAP_FAILED)
+        return false;
+    writer->segment = static_cast<char *>(p);
+    writer->segment_offset = offset;
+    writer->position = 0;
+    return true;
+}
+
+bool recording_open_write(recording_writer *writer, const char *path, const char *const *names, size_t count)
+{
+    writer->segment = nullptr;
+    writer->index_fd = -1;
+    writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(writer->fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    std::string index_path = std::string(path) + RECORDING_INDEX_SUFFIX;
+    writer->index_fd = open(index_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if(writer->index_fd < 0)
+    {
+        perror(index_path.c_str());
+        return false;
+    }
+    size_t names_length = 0;
+    for(size_t i = 0; i < count; i++)
+        names_length += strlen(names[i]) + 1;
+    if(RECORDING_HEADER_SIZE + names_length > RECORDING_SEGMENT_SIZE
+    || !write_all(writer->index_fd, RECORDING_INDEX_MAGIC, 8)
+    || !map_write_segment(writer, 0))
+        return false;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    writer->start_us = static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+    char *p = writer->segment;
+    memcpy(p, RECORDING_MAGIC, 8);
+    put_le(p + 8, writer->start_us, 8);
+    put_le(p + 16, RECORDING_SEGMENT_SIZE, 4);
+    put_le(p + 20, count, 4);
+    put_le(p + 24, names_length, 4);
+    put_le(p + 28, 0, 4);
+    char *name = p + RECORDING_HEADER_SIZE;
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t length = strlen(names[i]) + 1;
+        memcpy(name, names[i], length);
+        name += length;
+    }
+    writer->position = padded(RECORDING_HEADER_SIZE + names_length);
+    return true;
+}
+
+bool recording_append(recording_writer *writer, enum Recording_Kind kind, int type, uint16_t event_counter, uint64_t timestamp_us, const char *value, size_t length)
+{
+    if(length > RECORDING_MAX_VALUE)
+        length = RECORDING_MAX_VALUE;
+    size_t needed = RECORDING_RECORD_HEADER_SIZE + padded(length);
+    if(writer->position + needed > RECORDING_SEGMENT_SIZE)
+    {   //on to the next segment, readers skip whatever is left of this one
+        if(RECORDING_SEGMENT_SIZE - writer->position >= RECORDING_RECORD_HEADER_SIZE)
+            put_le(writer->segment + writer->position, RECORDING_SKIP, 2);
+        munmap(writer->segment, RECORDING_SEGMENT_SIZE);
+        writer->segment = nullptr;
+        if(!map_write_segment(writer, writer->segment_offset + RECORDING_SEGMENT_SIZE))
+            return false;
+    }
+    char *p = writer->segment + writer->position;
+    memcpy(p + RECORDING_RECORD_HEADER_SIZE, value, length);
+    put_le(p + 2, event_counter, 2);
+    put_le(p + 4, static_cast<uint64_t>(type), 4);
+    put_le(p + 8, timestamp_us, 8);
+    put_le(p + 16, length, 4);
+    put_le(p + 20, 0, 4);
+    std::atomic_signal_fence(std::memory_order_release); //the kind goes in last, it's what makes the record readable
+    put_le(p, static_cast<uint64_t>(kind), 2);
+    writer->position += needed;
+    return true;
+}
+
+bool recording_index(recording_writer *writer, uint64_t timestamp_us)
+{
+    char entry[RECORDING_INDEX_ENTRY_SIZE];
+    put_le(entry, timestamp_us, 8);
+    put_le(entry + 8, writer->segment_offset + writer->position, 8);
+    return write_all(writer->index_fd, entry, sizeof(entry));
+}
+
+void recording_close_write(recording_writer *writer)
+{
+    if(writer->segment)
+    {
+        munmap(writer->segment, RECORDING_SEGMENT_SIZE);
+        writer->segment = nullptr;
+        if(ftruncate(writer->fd, static_cast<off_t>(writer->segment_offset + writer->position)) != 0)
+            perror("ftruncate");
+    }
+    if(writer->fd >= 0)
+        close(writer->fd);
+    if(writer->index_fd >= 0)
+        close(writer->index_fd);
+    writer->fd = -1;
+    writer->index_fd = -1;
+}
+
+static bool map_read_segment(recording_reader *reader, uint64_t offset)
+{
+    if(reader->segment && reader->segment_offset == offset)
+        return true;
+    if(reader->segment)
+        munmap(const_cast<char *>(reader->segment), reader->segment_length);
+    reader->segment = nullptr;
+    if(offset >= reader->file_size)
+        return false;
+    uint64_t length = reader->file_size - offset < reader->segment_size ? reader->file_size - offset : reader->segment_size;
+    void *p = mmap(nullptr, static_cast<size_t>(length), PROT_READ, MAP_SHARED, reader->fd, static_cast<off_t>(offset));
+    if(p == MAP_FAILED)
+        return false;
+    madvise(p, static_cast<size_t>(length), MADV_SEQUENTIAL); //pages behind the reader can be dropped, hours of recording never sit in memory
+    reader->segment = static_cast<const char *>(p);
+    reader->segment_offset = offset;
+    reader->segment_length = static_cast<size_t>(length);
+    return true;
+}
+
+/** Reads the index if there's a usable one, it's small: 16 bytes per keyframe. */
+static void read_index(recording_reader *reader, const char *path)
+{
+    std::string index_path = std::string(path) + RECORDING_INDEX_SUFFIX;
+    int fd = open(index_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return;
+    struct stat st;
+    char magic[8];
+    if(fstat(fd, &st) != 0 || st.st_size < 8 || !read_at(fd, magic, 8, 0) || memcmp(magic, RECORDING_INDEX_MAGIC, 8) != 0)
+    {
+        close(fd);
+        return;
+    }
+    size_t count = (static_cast<size_t>(st.st_size) - 8) / RECORDING_INDEX_ENTRY_SIZE;
+    std::vector<char> entries(count * RECORDING_INDEX_ENTRY_SIZE + 1);
+    if(read_at(fd, &entries[0], count * RECORDING_INDEX_ENTRY_SIZE, 8))
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            uint64_t timestamp = get_le(&entries[i * RECORDING_INDEX_ENTRY_SIZE], 8);
+            uint64_t offset = get_le(&entries[i * RECORDING_INDEX_ENTRY_SIZE + 8], 8);
+            if(offset < reader->data_start || offset >= reader->file_size
+            || (!reader->index.empty() && timestamp < reader->index[reader->index.size() - 2]))
+                break; //written after the recording was cut off, or not this recording's
+            reader->index.push_back(timestamp);
+            reader->index.push_back(offset);
+        }
+    }
+    close(fd);
+}
+
+bool recording_open_read(recording_reader *reader, const char *path)
+{
+    reader->segment = nullptr;
+    reader->index.clear();
+    reader->types.clear();
+    reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(reader->fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    char header[RECORDING_HEADER_SIZE];
+    if(fstat(reader->fd, &st) != 0 || st.st_size < RECORDING_HEADER_SIZE
+    || !read_at(reader->fd, header, sizeof(header), 0) || memcmp(header, RECORDING_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "'%s' isn't a whiteboard recording\n", path);
+        return false;
+    }
+    reader->file_size = static_cast<uint64_t>(st.st_size);
+    reader->start_us = get_le(header + 8, 8);
+    reader->segment_size = get_le(header + 16, 4);
+    size_t count = static_cast<size_t>(get_le(header + 20, 4));
+    size_t names_length = static_cast<size_t>(get_le(header + 24, 4));
+    long page = sysconf(_SC_PAGESIZE);
+    if(reader->segment_size == 0 || reader->segment_size % static_cast<uint64_t>(page > 0 ? page : 4096) != 0
+    || RECORDING_HEADER_SIZE + names_length > reader->segment_size || RECORDING_HEADER_SIZE + names_length > reader->file_size)
+    {
+        fprintf(stderr, "'%s' has a malformed header\n", path);
+        return false;
+    }
+
+    //the recording's type names, onto this whiteboard's type indexes
+    std::vector<char> names(names_length + 1);
+    if(!read_at(reader->fd, &names[0], names_length, RECORDING_HEADER_SIZE))
+        return false;
+    names[names_length] = '\0';
+    const char *name = &names[0];
+    for(size_t i = 0; i < count && name < &names[names_length]; i++)
+    {
+        size_t length = strlen(name);
+        reader->types.push_back(wb_find_type(name, length));
+        name += length + 1;
+    }
+    reader->data_start = padded(RECORDING_HEADER_SIZE + names_length);
+
+    read_index(reader, path);
+    //the last record is at most a keyframe interval past the last index entry
+    recording_seek_keyframe(reader, UINT64_MAX);
+    reader->duration_us = 0;
+    recording_record record;
+    while(recording_next(reader, &record))
+        reader->duration_us = record.timestamp_us;
+    reader->position = reader->data_start;
+    return true;
+}
+
+bool recording_next(recording_reader *reader, recording_record *record)
+{
+    while(reader->position < reader->file_size)
+    {
+        uint64_t segment_offset = reader->position - reader->position % reader->segment_size;
+        if(!map_read_segment(reader, segment_offset))
+            return false;
+        size_t within = static_cast<size_t>(reader->position - segment_offset);
+        size_t remaining = reader->segment_length - within;
+        const char *p = reader->segment + within;
+        if(remaining < RECORDING_RECORD_HEADER_SIZE || get_le(p, 2) == RECORDING_SKIP)
+        {
+            reader->position = segment_offset + reader->segment_size;
+            continue;
+        }
+        uint64_t kind = get_le(p, 2);
+        size_t length = static_cast<size_t>(get_le(p + 16, 4));
+        if((kind != RECORDING_VALUE && kind != RECORDING_KEYFRAME) || length > remaining - RECORDING_RECORD_HEADER_SIZE)
+            return false; //the end, or where a cut off recording stops
+        size_t type = static_cast<size_t>(get_le(p + 4, 4));
+        record->kind = static_cast<enum Recording_Kind>(kind);
+        record->event_counter = static_cast<uint16_t>(get_le(p + 2, 2));
+        record->type = type < reader->types.size() ? reader->types[type] : -1;
+        record->timestamp_us = get_le(p + 8, 8);
+        record->value = p + RECORDING_RECORD_HEADER_SIZE;
+        record->length = length;
+        reader->position += RECORDING_RECORD_HEADER_SIZE + padded(length);
+        return true;
+    }
+    return false;
+}
+
+void recording_seek_keyframe(recording_reader *reader, uint64_t timestamp_us)
+{
+    size_t low = 0;
+    size_t high = reader->index.size() / 2;
+    while(low < high)
+    {   //first entry after 'timestamp_us'
+        size_t middle = low + (high - low) / 2;
+        if(reader->index[middle * 2] <= timestamp_us)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    reader->position = low > 0 ? reader->index[(low - 1) * 2 + 1] : reader->data_start;
+}
+
+void recording_close_read(recording_reader *reader)
+{
+    if(reader->segment)
+        munmap(const_cast<char *>(reader->segment), reader->segment_length);
+    reader->segment = nullptr;
+    if(reader->fd >= 0)
+        close(reader->fd);
+    reader->fd = -1;
+}
+
+typedef struct recorder_s
+{
+    std::mutex lock;
+    std::condition_variable wake;       ///< the recorder is stopping
+    bool stopping;
+    std::vector<int> types;             ///< types being recorded
+    std::vector<uint16_t> counters;     ///< event counter each was last recorded at, by position in 'types'
+    recording_writer writer;
+    gu_simple_whiteboard_descriptor *wbd; ///< the recorder's own descriptor
+    std::thread *thread;
+} recorder;
+
+//allocated once for the life of the server, only the recorder thread and serverd() use it
+static recorder *rec = nullptr;
+
+/**
+ * Polls the event counters without any lock and copies out only the slots
+ * that moved, one at a time.  Every RECORDING_KEYFRAME_INTERVAL_US the
+ * unchanged types are recorded too, as a keyframe to seek to.
+ */
+static void record_run(void)
+{
+    gu_simple_message *message = new gu_simple_message();
+    uint64_t start_ns = monotonic_ns();
+    uint64_t last_keyframe = 0;
+    bool first = true;
+    std::unique_lock<std::mutex> lock(rec->lock);
+    while(!rec->stopping)
+    {
+        lock.unlock();
+        uint64_t now = first ? 0 : (monotonic_ns() - start_ns) / 1000; //a pass's records share its time, a seek to it restores them all
+        bool keyframe = first || now - last_keyframe >= RECORDING_KEYFRAME_INTERVAL_US;
+        bool ok = !keyframe || recording_index(&rec->writer, now);
+        if(keyframe)
+            last_keyframe = now;
+        for(size_t i = 0; i < rec->types.size() && ok; i++)
+        {
+            int type = rec->types[i];
+            uint16_t counter = wb_type_event_counter(rec->wbd, type);
+            bool changed = !first && counter != rec->counters[i];
+            if(!changed && !keyframe)
+                continue;
+            wb_copy_slot(rec->wbd, type, message, &counter);
+            char *value = whiteboard_getmsg(type, message);
+            ok = recording_append(&rec->writer, changed ? RECORDING_VALUE : RECORDING_KEYFRAME, type, counter, now, value, strlen(value));
+            free(value);
+            rec->counters[i] = counter;
+        }
+        first = false;
+        lock.lock();
+        if(!ok)
+        {
+            fprintf(stderr, "Recording stopped, the recording couldn't be written: %s\n", strerror(errno));
+            break;
+        }
+        rec->wake.wait_for(lock, std::chrono::milliseconds(RECORDING_SAMPLE_INTERVAL_MS), [] { return rec->stopping; });
+    }
+    delete message;
+}
+
+/** Frees what recorder_start() had set up when it can't start the recorder thread. */
+static void recorder_discard(void)
+{
+    delete rec;
+    rec = nullptr;
+}
+
+bool recorder_start(const char *wbname, const char *path, const int *types, size_t count)
+{
+    rec = new recorder();
+    rec->stopping = false;
+    rec->thread = nullptr;
+    std::vector<bool> chosen(GSW_NUM_TYPES_DEFINED, false);
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!wb_type(types[i])->parsable || chosen[static_cast<size_t>(types[i])])
+            continue;
+        chosen[static_cast<size_t>(types[i])] = true;
+        rec->types.push_back(types[i]);
+    }
+    rec->counters.assign(rec->types.size(), 0);
+    if(rec->types.empty())
+    {
+        fprintf(stderr, "No parsable types to record\n");
+        recorder_discard();
+        return false;
+    }
+
+    std::vector<const char *> names(GSW_NUM_TYPES_DEFINED);
+    for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+        names[static_cast<size_t>(i)] = wb_type(i)->name;
+    if(!recording_open_write(&rec->writer, path, &names[0], names.size()))
+    {
+        recording_close_write(&rec->writer);
+        recorder_discard();
+        return false;
+    }
+    rec->wbd = gsw_new_whiteboard(wbname);
+    if(!rec->wbd)
+    {
+        recording_close_write(&rec->writer);
+        recorder_discard();
+        return false;
+    }
+    rec->thread = new std::thread(record_run);
+    fprintf(stderr, "Recording %zu types to '%s'\n", rec->types.size(), path);
+    return true;
+}
+
+void recorder_stop(void)
+{
+    if(!rec || !rec->thread)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(rec->lock);
+        rec->stopping = true;
+    }
+    rec->wake.notify_one();
+    rec->thread->join();
+    delete rec->thread;
+    rec->thread = nullptr;
+    recording_close_write(&rec->writer);
+    gsw_free_whiteboard(rec->wbd);
+}
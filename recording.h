@@ -0,0 +1,149 @@
+/**
+ *  /file guwhiteboardwebposter/recording.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#define RECORDING_MAGIC "GUWBREC1"              ///< first 8 bytes of a recording
+#define RECORDING_INDEX_MAGIC "GUWBIDX1"        ///< first 8 bytes of its index
+#define RECORDING_INDEX_SUFFIX ".idx"           ///< the index is kept beside the recording, with this appended to its name
+#define RECORDING_SEGMENT_SIZE (16 * 1024 * 1024) ///< bytes mapped at a time, no record crosses a segment boundary
+#define RECORDING_HEADER_SIZE 32                ///< bytes before the type names
+#define RECORDING_RECORD_HEADER_SIZE 24         ///< bytes before a record's value
+#define RECORDING_INDEX_ENTRY_SIZE 16
+#define RECORDING_MAX_VALUE (64 * 1024)         ///< longer values are cut short
+#define RECORDING_SAMPLE_INTERVAL_MS 5          ///< how often the recorder looks at the event counters
+#define RECORDING_KEYFRAME_INTERVAL_US 10000000 ///< how often every type is recorded, and indexed, so a seek can restore them all
+
+/**
+ * A recording is a header, then length prefixed records, appended through a
+ * shared mapping of one segment at a time.  Every field is little endian.
+ *
+ *     offset 0   char[8] RECORDING_MAGIC
+ *     offset 8   uint64  when recording started, microseconds since the epoch
+ *     offset 16  uint32  segment size
+ *     offset 20  uint32  number of type names that follow
+ *     offset 24  uint32  bytes of type names that follow
+ *     offset 28  uint32  reserved, 0
+ *     offset 32  NUL terminated type names, the type index is the position in
+ *                the list, so a recording can be replayed by a differently
+ *                built whiteboard.  Records start at the next multiple of 8.
+ *
+ * Each record is a header, its value, then padding to a multiple of 8:
+ *
+ *     offset 0   uint16  Recording_Kind
+ *     offset 2   uint16  event counter the slot was copied at
+ *     offset 4   uint32  type index in the recording's name list
+ *     offset 8   uint64  microseconds since recording started
+ *     offset 16  uint32  value length
+ *     offset 20  uint32  reserved, 0
+ *
+ * The kind is written last and unwritten space is zeros, so a recording cut
+ * off by a crash or SIGKILL still reads up to its last whole record.  When
+ * a record doesn't fit in what is left of a segment it goes at the start of
+ * the next one, and the rest of the segment is skipped.
+ *
+ * The index is RECORDING_INDEX_MAGIC, then a (uint64 microseconds, uint64
+ * file offset) pair for the start of every keyframe: a pass that records
+ * every type, whether it changed or not.
+ */
+enum Recording_Kind
+{
+    RECORDING_END = 0,          ///< no more records
+    RECORDING_VALUE,            ///< a type's value changed
+    RECORDING_KEYFRAME,         ///< a type's unchanged value, recorded so a seek can restore it
+    RECORDING_SKIP              ///< the rest of the segment is unused
+};
+
+/** one record, its value points into the mapped segment */
+typedef struct recording_record_s
+{
+    enum Recording_Kind kind;
+    uint16_t event_counter;
+    int type;                   ///< local type index, -1 if this whiteboard doesn't have the recorded type
+    uint64_t timestamp_us;      ///< since recording started
+    const char *value;
+    size_t length;
+} recording_record;
+
+/** appends records to a recording through a writable mapping of its last segment */
+typedef struct recording_writer_s
+{
+    int fd;
+    int index_fd;
+    char *segment;              ///< the mapped segment being written
+    uint64_t segment_offset;    ///< file offset of 'segment'
+    size_t position;            ///< next write within 'segment'
+    uint64_t start_us;          ///< when recording started, microseconds since the epoch
+} recording_writer;
+
+/** reads a recording through a read only mapping of one segment at a time */
+typedef struct recording_reader_s
+{
+    int fd;
+    uint64_t file_size;
+    uint64_t segment_size;
+    const char *segment;        ///< the mapped segment, nullptr if none is
+    uint64_t segment_offset;    ///< file offset of 'segment'
+    size_t segment_length;      ///< bytes mapped, less than the segment size for the last one
+    uint64_t position;          ///< file offset of the next record
+    uint64_t data_start;        ///< file offset of the first record
+    uint64_t start_us;          ///< when recording started, microseconds since the epoch
+    uint64_t duration_us;       ///< timestamp of the last record
+    std::vector<int> types;     ///< recorded type index to local type index, -1 for unknown types
+    std::vector<uint64_t> index;    ///< (timestamp, offset) pairs, in order
+} recording_reader;
+
+/**
+ * Creates (or truncates) 'path' and its index, and writes the header.
+ * 'names' are the whiteboard's type names, by type index.
+ */
+bool recording_open_write(recording_writer *writer, const char *path, const char *const *names, size_t count);
+
+/** Appends a record, 'timestamp_us' is since recording started. */
+bool recording_append(recording_writer *writer, enum Recording_Kind kind, int type, uint16_t event_counter, uint64_t timestamp_us, const char *value, size_t length);
+
+/** Notes that a keyframe starts with the next record. */
+bool recording_index(recording_writer *writer, uint64_t timestamp_us);
+
+/** Unmaps the last segment and trims the file to the records written. */
+void recording_close_write(recording_writer *writer);
+
+/**
+ * Opens a recording and its index (a recording without one can still be
+ * played, only seeking is slower), maps its type names onto this
+ * whiteboard's and finds its duration.
+ */
+bool recording_open_read(recording_reader *reader, const char *path);
+
+/** Reads the next record, false at the end of the recording. */
+bool recording_next(recording_reader *reader, recording_record *record);
+
+/** Positions the reader at the last keyframe at or before 'timestamp_us'. */
+void recording_seek_keyframe(recording_reader *reader, uint64_t timestamp_us);
+
+void recording_close_read(recording_reader *reader);
+
+/**
+ * Starts the recorder thread, on its own descriptor for 'wbname'.  Every
+ * time the event counter of one of the 'count' types moves, the type's slot
+ * is copied (holding the whiteboard lock for just that copy), serialised and
+ * appended to 'path'.  Types without a string getter are skipped.
+ */
+bool recorder_start(const char *wbname, const char *path, const int *types, size_t count);
+
+/** Stops the recorder thread and closes the recording. */
+void recorder_stop(void);
+
+#endif //RECORDING_H
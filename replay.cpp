@@ -0,0 +1,382 @@
+/**
+ *  /file guwhiteboardwebposter/replay.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gusimplewhiteboard.h"
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "cbor.h"
+#include "json.h"
+#include "recording.h"
+#include "replay.h"
+#include "server.h"
+
+static const char *state_names[NUM_REPLAY_STATES] = { "stopped", "playing", "finished" };
+
+typedef struct replay_s
+{
+    std::mutex lock;
+    std::condition_variable wake;       ///< a command came in, or the replay is closing
+    recording_reader reader;            ///< replay thread only, apart from the header fields read by requests
+    std::string path;
+    enum Replay_State state;
+    double speed;
+    uint64_t position_us;               ///< recording time of the last record posted, or of the last seek
+    uint64_t anchor_us;                 ///< recording time that was due at 'anchor_time'
+    std::chrono::steady_clock::time_point anchor_time;
+    uint64_t generation;                ///< moves on every command, so the replay thread stops waiting and looks again
+    bool seek_pending;
+    uint64_t seek_to;
+    bool restored;                      ///< whether every type has been set to its value at 'position_us'
+    uint64_t posted;                    ///< records posted
+    uint64_t skipped;                   ///< records of types this whiteboard doesn't have, or its parser refused
+    bool closing;
+    gu_simple_whiteboard_descriptor *wbd; ///< the replay thread's own descriptor
+    std::thread *thread;
+} replay;
+
+//allocated once for the life of the server, requests on every worker read and command it
+static replay *player = nullptr;
+
+/**
+ * Sets every type to the last value it was recorded with at or before
+ * 'target', posting each once, and leaves the reader at the next record.
+ * Reading starts from the keyframe before it, so at most a keyframe
+ * interval of the recording is read.
+ */
+static void restore(uint64_t target, std::vector<std::string> *latest, std::vector<bool> *have, uint64_t *posted, uint64_t *skipped)
+{
+    recording_reader *reader = &player->reader;
+    recording_seek_keyframe(reader, target);
+    have->assign(have->size(), false);
+    recording_record record;
+    while(true)
+    {
+        uint64_t before = reader->position;
+        if(!recording_next(reader, &record))
+            break;
+        if(record.timestamp_us > target)
+        {
+            reader->position = before;
+            break;
+        }
+        if(record.type == -1)
+            continue;
+        (*latest)[static_cast<size_t>(record.type)].assign(record.value, record.length);
+        (*have)[static_cast<size_t>(record.type)] = true;
+    }
+    for(size_t type = 0; type < have->size(); type++)
+    {
+        if(!(*have)[type])
+            continue;
+        //posted directly rather than through wb_post(), this thread isn't a worker with request metrics
+        if(guWhiteboard::postmsg(static_cast<WBTypes>(type), (*latest)[type], player->wbd))
+            (*posted)++;
+        else
+            (*skipped)++;
+    }
+}
+
+/**
+ * Posts each record when its time comes round, recording time being mapped
+ * onto the steady clock through the anchor and the speed.  A command moves
+ * 'generation' on, which cuts a wait short so the record is timed again.
+ */
+static void replay_run(void)
+{
+    std::vector<std::string> latest(GSW_NUM_TYPES_DEFINED);
+    std::vector<bool> have(GSW_NUM_TYPES_DEFINED, false);
+    std::string value;
+    recording_record record;
+    std::unique_lock<std::mutex> lock(player->lock);
+    while(!player->closing)
+    {
+        if(player->seek_pending)
+        {
+            uint64_t target = player->seek_to;
+            player->seek_pending = false;
+            uint64_t posted = 0;
+            uint64_t skipped = 0;
+            lock.unlock();
+            restore(target, &latest, &have, &posted, &skipped);
+            lock.lock();
+            player->posted += posted;
+            player->skipped += skipped;
+            player->restored = true;
+            player->anchor_us = target;
+            player->anchor_time = std::chrono::steady_clock::now();
+            continue;
+        }
+        if(player->state != REPLAY_PLAYING)
+        {
+            player->wake.wait(lock, [] { return player->closing || player->seek_pending || player->state == REPLAY_PLAYING; });
+            continue;
+        }
+
+        uint64_t before = player->reader.position;
+        if(!recording_next(&player->reader, &record))
+        {
+            player->state = REPLAY_FINISHED;
+            player->position_us = player->reader.duration_us;
+            continue;
+        }
+        if(record.kind == RECORDING_KEYFRAME)
+            continue; //only there for seeking, the value hasn't changed
+
+        uint64_t generation = player->generation;
+        double delay_us = (static_cast<double>(record.timestamp_us) - static_cast<double>(player->anchor_us)) / player->speed;
+        std::chrono::steady_clock::time_point due = player->anchor_time
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(delay_us));
+        if(player->wake.wait_until(lock, due, [generation] { return player->closing || player->generation != generation; }))
+        {
+            player->reader.position = before; //read it again once the command has been dealt with
+            continue;
+        }
+
+        lock.unlock();
+        bool posted = false;
+        if(record.type != -1)
+        {
+            value.assign(record.value, record.length);
+            posted = guWhiteboard::postmsg(static_cast<WBTypes>(record.type), value, player->wbd);
+        }
+        lock.lock();
+        if(posted)
+            player->posted++;
+        else
+            player->skipped++;
+        player->position_us = record.timestamp_us;
+    }
+}
+
+/** Frees what replay_start() had set up when it can't start the replay thread. */
+static void replay_discard(void)
+{
+    recording_close_read(&player->reader);
+    delete player;
+    player = nullptr;
+}
+
+bool replay_start(const char *wbname, const char *path)
+{
+    player = new replay();
+    player->thread = nullptr;
+    player->path = path;
+    if(!recording_open_read(&player->reader, path))
+    {
+        replay_discard();
+        return false;
+    }
+    player->state = REPLAY_STOPPED;
+    player->speed = 1.0;
+    player->position_us = 0;
+    player->anchor_us = 0;
+    player->generation = 0;
+    player->seek_pending = false;
+    player->seek_to = 0;
+    player->restored = false;
+    player->posted = 0;
+    player->skipped = 0;
+    player->closing = false;
+    player->wbd = gsw_new_whiteboard(wbname);
+    if(!player->wbd)
+    {
+        replay_discard();
+        return false;
+    }
+    player->thread = new std::thread(replay_run);
+    fprintf(stderr, "Replaying '%s', %.1f s long, POST commands to /replay\n", path, static_cast<double>(player->reader.duration_us) / 1e6);
+    return true;
+}
+
+void replay_stop(void)
+{
+    if(!player || !player->thread)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(player->lock);
+        player->closing = true;
+    }
+    player->wake.notify_one();
+    player->thread->join();
+    delete player->thread;
+    player->thread = nullptr;
+    recording_close_read(&player->reader);
+    gsw_free_whiteboard(player->wbd);
+}
+
+static bool parse_number(const std::string &text, double *value)
+{
+    char *end;
+    *value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(*value);
+}
+
+/** Carries out a command, with the lock held.  False if it isn't one. */
+static bool replay_command(const std::vector<json_member> &members)
+{
+    const std::string *command = nullptr;
+    const std::string *speed = nullptr;
+    const std::string *position = nullptr;
+    for(size_t i = 0; i < members.size(); i++)
+    {
+        if(members[i].name == "command")
+            command = &members[i].value;
+        else if(members[i].name == "speed")
+            speed = &members[i].value;
+        else if(members[i].name == "position")
+            position = &members[i].value;
+    }
+    if(!command)
+        return false;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(*command == "start")
+    {
+        if(player->state == REPLAY_FINISHED)
+            player->position_us = 0; //again from the beginning
+        if(player->state == REPLAY_FINISHED || !player->restored)
+        {
+            player->seek_pending = true;
+            player->seek_to = player->position_us;
+        }
+        player->state = REPLAY_PLAYING;
+        player->anchor_us = player->position_us;
+        player->anchor_time = now;
+    }
+    else if(*command == "stop")
+    {
+        if(player->state == REPLAY_PLAYING)
+            player->state = REPLAY_STOPPED;
+    }
+    else if(*command == "speed")
+    {
+        double value;
+        if(!speed || !parse_number(*speed, &value) || value <= 0 || value > REPLAY_MAX_SPEED)
+            return false;
+        if(player->state == REPLAY_PLAYING)
+        {   //carry on from where playback has got to, at the new rate
+            double elapsed_us = std::chrono::duration<double, std::micro>(now - player->anchor_time).count();
+            uint64_t reached = player->anchor_us + static_cast<uint64_t>(elapsed_us * player->speed);
+            player->anchor_us = reached > player->position_us ? reached : player->position_us;
+            player->anchor_time = now;
+        }
+        player->speed = value;
+    }
+    else if(*command == "seek")
+    {
+        double value;
+        if(!position || !parse_number(*position, &value) || value < 0)
+            return false;
+        uint64_t target = value < static_cast<double>(player->reader.duration_us) ? static_cast<uint64_t>(value) : player->reader.duration_us;
+        player->seek_pending = true;
+        player->seek_to = target;
+        player->position_us = target;
+        if(player->state == REPLAY_FINISHED)
+            player->state = REPLAY_STOPPED;
+    }
+    else
+        return false;
+    player->generation++;
+    return true;
+}
+
+static void replay_status(struct connection_s *conn, struct header_info_s *header)
+{
+    enum Content_Type representation = header->accept == Application_cbor ? Application_cbor
+                                     : header->accept == Application_vnd_api_json ? Application_vnd_api_json : Application_json;
+    enum Replay_State state;
+    double speed;
+    uint64_t position;
+    uint64_t posted;
+    uint64_t skipped;
+    {
+        std::lock_guard<std::mutex> lock(player->lock);
+        state = player->state;
+        speed = player->speed;
+        position = player->position_us;
+        posted = player->posted;
+        skipped = player->skipped;
+    }
+
+    arena_text response;
+    arena_text_init(&response, &conn->scratch);
+    if(representation == Application_cbor)
+    {
+        cbor_put_map(&response, 8);
+        cbor_put_text_str(&response, "file");
+        cbor_put_text(&response, player->path.data(), player->path.length());
+        cbor_put_text_str(&response, "state");
+        cbor_put_text_str(&response, state_names[state]);
+        cbor_put_text_str(&response, "speed");
+        cbor_put_double(&response, speed);
+        cbor_put_text_str(&response, "position_us");
+        cbor_put_uint(&response, position);
+        cbor_put_text_str(&response, "duration_us");
+        cbor_put_uint(&response, player->reader.duration_us);
+        cbor_put_text_str(&response, "recorded_at_us");
+        cbor_put_uint(&response, player->reader.start_us);
+        cbor_put_text_str(&response, "posted");
+        cbor_put_uint(&response, posted);
+        cbor_put_text_str(&response, "skipped");
+        cbor_put_uint(&response, skipped);
+    }
+    else
+    {
+        arena_text_append_str(&response, "{\"file\":");
+        json_append_string(&response, player->path.data(), player->path.length());
+        char fields[256];
+        int n = snprintf(fields, sizeof(fields), ", \"state\":\"%s\", \"speed\":%g, \"position_us\":%llu, \"duration_us\":%llu, \"recorded_at_us\":%llu, \"posted\":%llu, \"skipped\":%llu}",
+                         state_names[state], speed, static_cast<unsigned long long>(position), static_cast<unsigned long long>(player->reader.duration_us),
+                         static_cast<unsigned long long>(player->reader.start_us), static_cast<unsigned long long>(posted), static_cast<unsigned long long>(skipped));
+        arena_text_append(&response, fields, static_cast<size_t>(n));
+    }
+    body_part body = { response.data, response.length, false };
+    generate_response_parts(conn, header->version, _200_OK, Content_Type_Strings[representation], &body, 1, "Cache-Control: no-cache\r\n");
+}
+
+void handle_replay(struct connection_s *conn, struct header_info_s *header, char *body)
+{
+    if(!player || !player->thread)
+    {
+        generate_response(conn, header->version, _404_Not_Found, Application_json, "");
+        return;
+    }
+    if(header->verb == HTTP_POST)
+    {
+        std::vector<json_member> members;
+        bool ok = json_parse_object(body, strlen(body), &members);
+        if(ok)
+        {
+            std::lock_guard<std::mutex> lock(player->lock);
+            ok = replay_command(members);
+        }
+        if(!ok)
+        {
+            generate_response(conn, header->version, _400_Bad_Request, Application_json, "");
+            return;
+        }
+        player->wake.notify_one();
+    }
+    else if(header->verb != HTTP_GET)
+    {
+        generate_response(conn, header->version, _501_Not_Implemented, Application_json, "");
+        return;
+    }
+    replay_status(conn, header);
+}
@@ -0,0 +1,47 @@
+/**
+ *  /file guwhiteboardwebposter/replay.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "guwhiteboardwebposter.h"
+
+#define REPLAY_MAX_SPEED 1000.0     ///< fastest a recording can be played, times real time
+
+enum Replay_State
+{
+    REPLAY_STOPPED = 0,
+    REPLAY_PLAYING,
+    REPLAY_FINISHED,            ///< played to the end, start plays it again from the beginning
+    NUM_REPLAY_STATES
+};
+
+/**
+ * Opens a recording made with -R and starts the replay thread, on its own
+ * descriptor for 'wbname'.  Nothing is posted until a start command.
+ */
+bool replay_start(const char *wbname, const char *path);
+
+/** Stops the replay thread and closes the recording. */
+void replay_stop(void);
+
+/**
+ * /replay controls the replay of the recording given with -P.
+ *     GET answers its state, JSON or CBOR.
+ *     POST takes a JSON command and answers the new state:
+ *         {"command":"start"}                  play from the current position
+ *         {"command":"stop"}                   pause at the current position
+ *         {"command":"speed", "speed":2.5}     times real time, up to REPLAY_MAX_SPEED
+ *         {"command":"seek", "position":N}     microseconds into the recording; every
+ *                                              type is set to its value at that point
+ * Records are re-posted through each type's string parser at their recorded
+ * timing, divided by the speed.  404 if there is no recording to replay.
+ */
+void handle_replay(struct connection_s *conn, struct header_info_s *header, char *body);
+
+#endif //REPLAY_H
@@ -0,0 +1,150 @@
+/**
+ *  /file guwhiteboardwebposter/request_body.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstring>
+
+#include "request_body.h"
+
+enum Body_Status request_body_begin(request_body *body, bool chunked, int content_length, size_t max_size)
+{
+    body->data.clear();
+    body->max_size = max_size;
+    if(chunked)
+    {
+        body->state = BODY_CHUNK_SIZE;
+        body->remaining = 0;
+        return BODY_MORE;
+    }
+    body->remaining = content_length > 0 ? static_cast<size_t>(content_length) : 0;
+    if(body->remaining > max_size)
+        return BODY_TOO_LARGE;
+    body->data.reserve(body->remaining);
+    body->state = body->remaining > 0 ? BODY_FIXED : BODY_COMPLETE;
+    return body->remaining > 0 ? BODY_MORE : BODY_DONE;
+}
+
+static int hex_digit(char c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Parses '1a3;ext=x' up to the end of the line.
+ * Returns false if there are no digits or the size would overflow.
+ */
+static bool parse_chunk_size(const char *line, size_t length, size_t *size)
+{
+    size_t i = 0;
+    *size = 0;
+    for(; i < length && hex_digit(line[i]) != -1; i++)
+    {
+        if(*size > (static_cast<size_t>(-1) >> 4))
+            return false;
+        *size = (*size << 4) | static_cast<size_t>(hex_digit(line[i]));
+    }
+    return i > 0 && (i == length || line[i] == ';' || line[i] == ' ' || line[i] == '\t');
+}
+
+/** Finds the CRLF ending the line at 'in', returning the line length or -1 if it hasn't arrived. */
+static long line_length(const char *in, size_t length)
+{
+    const char *lf = static_cast<const char *>(memchr(in, '\n', length));
+    if(!lf || lf == in || lf[-1] != '\r')
+        return lf ? -2 : -1; //bare LF is malformed
+    return lf - in - 1;
+}
+
+enum Body_Status request_body_feed(request_body *body, const char *in, size_t length, size_t *used)
+{
+    size_t i = 0;
+    enum Body_Status status = BODY_MORE;
+    while(status == BODY_MORE && (i < length || body->state == BODY_COMPLETE))
+    {
+        switch(body->state)
+        {
+            case BODY_FIXED:
+            case BODY_CHUNK_DATA:
+            {
+                size_t n = length - i < body->remaining ? length - i : body->remaining;
+                body->data.append(in + i, n);
+                i += n;
+                body->remaining -= n;
+                if(body->remaining == 0)
+                    body->state = body->state == BODY_FIXED ? BODY_COMPLETE : BODY_CHUNK_DATA_END;
+                break;
+            }
+            case BODY_CHUNK_SIZE:
+            case BODY_CHUNK_DATA_END:
+            case BODY_TRAILER:
+            {
+                size_t available = length - i < CHUNK_LINE_MAX + 2 ? length - i : CHUNK_LINE_MAX + 2;
+                long line = line_length(in + i, available);
+                if(line == -2 || (line == -1 && available == CHUNK_LINE_MAX + 2))
+                {
+                    status = BODY_MALFORMED;
+                    break;
+                }
+                if(line == -1)
+                {
+                    *used = i; //wait for the rest of the line
+                    return BODY_MORE;
+                }
+                const char *text = in + i;
+                i += static_cast<size_t>(line) + 2;
+                if(body->state == BODY_CHUNK_DATA_END)
+                {
+                    if(line != 0)
+                        status = BODY_MALFORMED;
+                    body->state = BODY_CHUNK_SIZE;
+                }
+                else if(body->state == BODY_TRAILER)
+                {
+                    if(line == 0)
+                        body->state = BODY_COMPLETE;
+                }
+                else
+                {
+                    size_t size;
+                    if(!parse_chunk_size(text, static_cast<size_t>(line), &size))
+                        status = BODY_MALFORMED;
+                    else if(size > body->max_size - body->data.size())
+                        status = BODY_TOO_LARGE;
+                    else if(size == 0)
+                        body->state = BODY_TRAILER;
+                    else
+                    {
+                        body->remaining = size;
+                        body->state = BODY_CHUNK_DATA;
+                    }
+                }
+                break;
+            }
+            case BODY_COMPLETE:
+                status = BODY_DONE;
+                break;
+        }
+    }
+    *used = i;
+    return status;
+}
+
+void request_body_reset(request_body *body)
+{
+    if(body->data.capacity() > REQUEST_BODY_RETAINED_SIZE)
+        std::string().swap(body->data);
+    else
+        body->data.clear();
+    body->state = BODY_COMPLETE;
+    body->remaining = 0;
+}
@@ -0,0 +1,68 @@
+/**
+ *  /file guwhiteboardwebposter/request_body.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef REQUEST_BODY_H
+#define REQUEST_BODY_H
+
+#include <cstddef>
+#include <string>
+
+#define REQUEST_BODY_RETAINED_SIZE (64 * 1024) ///< storage kept between requests, anything bigger is released
+#define CHUNK_LINE_MAX 1024     ///< longest chunk size line (with extensions) or trailer line accepted
+
+/** where the decoder is up to in a body */
+enum Body_State
+{
+    BODY_FIXED = 0,             ///< copying the rest of a 'Content-Length' body
+    BODY_CHUNK_SIZE,            ///< waiting for a chunk size line
+    BODY_CHUNK_DATA,            ///< copying the current chunk
+    BODY_CHUNK_DATA_END,        ///< waiting for the CRLF after a chunk
+    BODY_TRAILER,               ///< skipping trailer fields until the blank line
+    BODY_COMPLETE               ///< whole body received
+};
+
+/** result of request_body_feed() */
+enum Body_Status
+{
+    BODY_DONE = 0,              ///< the body is complete, 'data' holds it
+    BODY_MORE,                  ///< everything given was used, send more
+    BODY_TOO_LARGE,             ///< body is bigger than max_size
+    BODY_MALFORMED              ///< bad chunked framing
+};
+
+/**
+ * A request body being received.  Bytes are decoded into 'data' as they
+ * arrive, so the connection's input buffer only ever holds what the last
+ * read brought in, however large the body is.
+ */
+typedef struct request_body_s
+{
+    std::string data;           ///< decoded body, always followed by a NUL
+    enum Body_State state;
+    size_t remaining;           ///< bytes left of the fixed body or the current chunk
+    size_t max_size;            ///< largest body accepted
+} request_body;
+
+/**
+ * Gets ready for the next request's body, 'content_length' is -1 if the
+ * request doesn't have one.  Chunked framing wins over 'Content-Length'.
+ * Returns BODY_TOO_LARGE straight away if the announced length is over the
+ * limit, so the client can be told before it sends the body.
+ */
+enum Body_Status request_body_begin(request_body *body, bool chunked, int content_length, size_t max_size);
+
+/**
+ * Decodes as much of 'in' as it can.  '*used' is set to how many bytes were
+ * taken; a chunk size line that hasn't fully arrived is left for next time.
+ */
+enum Body_Status request_body_feed(request_body *body, const char *in, size_t length, size_t *used);
+
+/** Clears the body for the next request, letting go of unusually large storage. */
+void request_body_reset(request_body *body);
+
+#endif //REQUEST_BODY_H
@@ -0,0 +1,116 @@
+/**
+ *  /file guwhiteboardwebposter/response_stream.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+
+#include "compress.h"
+#include "metrics.h"
+#include "response_stream.h"
+#include "server.h"
+
+/** Queues one piece of the body, framed as a chunk if the stream is chunked. */
+static void append_piece(connection *conn, const char *data, size_t length)
+{
+    if(length == 0)
+        return; //an empty chunk would end the body
+    if(conn->stream.chunked)
+    {
+        char size[24];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", length);
+        write_queue_append(&conn->out, size, static_cast<size_t>(n));
+    }
+    write_queue_append(&conn->out, data, length);
+    if(conn->stream.chunked)
+        write_queue_append_str(&conn->out, "\r\n");
+}
+
+/** The body has all been queued, close the stream off. */
+static void finish(connection *conn)
+{
+    response_stream *stream = &conn->stream;
+    if(stream->chunked)
+        write_queue_append_str(&conn->out, "0\r\n\r\n");
+    if(stream->z)
+    {
+        request_metrics *metrics = metrics_local();
+        metrics_add(&metrics->compressed_responses, 1);
+        metrics_add(&metrics->compressed_bytes_in, stream->bytes_in);
+        metrics_add(&metrics->compressed_bytes_out, stream->bytes_out);
+        metrics_add(&metrics->compression_ns, stream->compression_ns);
+    }
+    response_stream_end(stream);
+    conn->state = CONN_WRITING; //the event loop drains 'out' before reading the next request
+}
+
+void response_stream_begin(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, enum HTTP_Version version, const char *content_type, const char *headers, stream_producer produce)
+{
+    if(version >= NUM_HTTP_VERSIONS)
+        version = HTTP_V1_1;
+    response_stream *stream = &conn->stream;
+    stream->produce = produce;
+    stream->row = 0;
+    stream->chunked = version == HTTP_V1_1;
+    stream->bytes_in = 0;
+    stream->bytes_out = 0;
+    stream->compression_ns = 0;
+    if(!stream->chunked)
+        conn->keep_alive = false; //HTTP/1.0 has no other way to tell where the body ends
+
+    //streamed bodies are listings, always big enough to be worth compressing
+    enum Content_Encoding encoding = conn->header_info.accept_encoding;
+    stream->z = compress_wanted(encoding, COMPRESS_MIN_SIZE) ? compress_stream_begin(encoding) : nullptr;
+
+    generate_response_head(conn, version, _200_OK, content_type, stream->chunked ? "Transfer-Encoding: chunked\r\n" : "",
+            stream->z ? encoding : Encoding_Identity, true, headers);
+    conn->state = CONN_PRODUCING;
+    response_stream_fill(conn, wbd); //first rows go out with the header
+}
+
+void response_stream_fill(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd)
+{
+    response_stream *stream = &conn->stream;
+    while(stream->produce && write_queue_pending(&conn->out) < RESPONSE_STREAM_LOW_WATER)
+    {
+        arena_text piece;
+        arena_text_init(&piece, &conn->scratch);
+        bool more = true;
+        while(piece.length < RESPONSE_STREAM_PIECE_SIZE && (more = stream->produce(wbd, stream->row, &piece)))
+            stream->row++;
+
+        if(stream->z)
+        {
+            uint64_t start = monotonic_ns();
+            arena_text packed;
+            arena_text_init(&packed, &conn->scratch);
+            if(!compress_stream_write(stream->z, piece.data, piece.length, !more, &packed))
+            {
+                //the header has gone, so all that can be done is to cut the body short
+                conn->keep_alive = false;
+                stream->chunked = false;
+                finish(conn);
+                return;
+            }
+            stream->compression_ns += monotonic_ns() - start;
+            stream->bytes_in += piece.length;
+            stream->bytes_out += packed.length;
+            append_piece(conn, packed.data, packed.length);
+        }
+        else
+            append_piece(conn, piece.data, piece.length);
+
+        if(!more)
+            finish(conn);
+    }
+}
+
+void response_stream_end(response_stream *stream)
+{
+    compress_stream_end(stream->z);
+    stream->z = nullptr;
+    stream->produce = nullptr;
+}
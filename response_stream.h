@@ -0,0 +1,58 @@
+/**
+ *  /file guwhiteboardwebposter/response_stream.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef RESPONSE_STREAM_H
+#define RESPONSE_STREAM_H
+
+#include "arena.h"
+#include "guwhiteboardwebposter.h"
+
+#define RESPONSE_STREAM_PIECE_SIZE (8 * 1024)   ///< body produced before it is sent as a chunk
+#define RESPONSE_STREAM_LOW_WATER (16 * 1024)   ///< more of the body is produced once less than this is queued
+
+/**
+ * Appends row 'row' of a body, rows are asked for in order from 0.
+ * Returns false, without appending anything, once 'row' is past the end.
+ */
+typedef bool (*stream_producer)(gu_simple_whiteboard_descriptor *wbd, int row, arena_text *out);
+
+/**
+ * A response body that is produced as the client takes it, rather than
+ * being built whole first.  It is sent with 'Transfer-Encoding: chunked'
+ * (or until the connection closes, for HTTP/1.0 clients), so only about
+ * RESPONSE_STREAM_LOW_WATER plus a piece of it is ever held at once.
+ */
+typedef struct response_stream_s
+{
+    stream_producer produce;            ///< nullptr when nothing is being streamed
+    int row;                            ///< next row to ask for
+    bool chunked;                       ///< chunked framing, otherwise the body ends when the connection does
+    struct compress_stream_s *z;        ///< deflate state if the body is compressed
+    size_t bytes_in;                    ///< body bytes produced, for the compression metrics
+    size_t bytes_out;                   ///< body bytes after compression
+    uint64_t compression_ns;            ///< time spent compressing
+} response_stream;
+
+/**
+ * Sends a '200 OK' header and starts streaming the rows of 'produce' as
+ * the body, compressed if the client accepts it.  The connection stays in
+ * CONN_PRODUCING until the last row has been queued.
+ */
+void response_stream_begin(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, enum HTTP_Version version, const char *content_type, const char *headers, stream_producer produce);
+
+/**
+ * Produces more of the body until RESPONSE_STREAM_LOW_WATER bytes are
+ * queued or it is finished.  Allocates from the connection's arena, which
+ * the caller resets once the output has been queued.
+ */
+void response_stream_fill(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd);
+
+/** Drops whatever is left of a stream, e.g. when its connection closes. */
+void response_stream_end(response_stream *stream);
+
+#endif //RESPONSE_STREAM_H
@@ -0,0 +1,863 @@
+/**
+ *  /file guwhiteboardwebposter/server.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <assert.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#include "guwhiteboardtypelist_generated.h"
+
+#include "alloc_stats.h"
+#include "assets.h"
+#include "compress.h"
+#include "events.h"
+#include "history.h"
+#include "post_queue.h"
+#include "recording.h"
+#include "replay.h"
+#include "server.h"
+#include "wb_types.h"
+
+#define MAX_EVENTS 64           ///< readiness events handled per wakeup
+#define SWEEP_INTERVAL_MS 1000  ///< how often idle connections are looked for
+#define MAX_PIPELINED_REQUESTS 16       ///< requests answered per read before output is drained
+#define MAX_PENDING_OUTPUT (64 * 1024)  ///< response bytes queued before pipelining pauses
+
+extern std::atomic<bool> aborting_server;
+
+enum Poll_Interest
+{
+    POLL_NONE = 0,
+    POLL_READ = 1,
+    POLL_WRITE = 2
+};
+
+/** readiness notification for one file descriptor */
+typedef struct poll_event_s
+{
+    int fd;
+    bool readable;
+    bool writable;
+    bool hangup;
+} poll_event;
+
+/** epoll on Linux, poll() everywhere else */
+typedef struct poller_s
+{
+#ifdef __linux__
+    int epoll_fd;
+#else
+    std::vector<struct pollfd> fds;
+    std::vector<int> slots;             ///< fd -> index into fds, -1 if not registered
+#endif
+} poller;
+
+/** everything one event loop owns, each worker thread has its own */
+typedef struct server_s
+{
+    socket_descriptor *sd;                  ///< listening socket
+    gu_simple_whiteboard_descriptor *wbd;
+    poller events;
+    std::vector<connection *> connections;  ///< indexed by file descriptor
+    event_stream_cache stream_cache;        ///< values last sent to this worker's event streams
+    size_t max_body_size;                   ///< larger request bodies are refused with 413
+} server;
+
+static uint64_t monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+}
+
+/** Nanoseconds since a kernel receive timestamp, 0 if there isn't one or the clock has stepped back. */
+static uint64_t ns_since(const struct timeval *received)
+{
+    if(received->tv_sec == 0)
+        return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t ns = (static_cast<int64_t>(now.tv_sec) - received->tv_sec) * 1000000000LL + (now.tv_nsec - static_cast<int64_t>(received->tv_usec) * 1000);
+    return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+}
+
+static bool set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if(flags == -1)
+        return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+#ifdef __linux__
+
+static bool poller_init(poller *p)
+{
+    p->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    return p->epoll_fd != -1;
+}
+
+static void poller_destroy(poller *p)
+{
+    close(p->epoll_fd);
+}
+
+static bool poller_set(poller *p, int fd, int interest, bool add)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    if(interest & POLL_READ)
+        ev.events |= EPOLLIN;
+    if(interest & POLL_WRITE)
+        ev.events |= EPOLLOUT;
+    ev.data.fd = fd;
+    return epoll_ctl(p->epoll_fd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+static void poller_remove(poller *p, int fd)
+{
+    struct epoll_event ev; //non-null for pre 2.6.9 kernels
+    epoll_ctl(p->epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+static int poller_wait(poller *p, poll_event *events, int max_events, int timeout_ms)
+{
+    struct epoll_event ready[MAX_EVENTS];
+    int n = epoll_wait(p->epoll_fd, &ready[0], max_events < MAX_EVENTS ? max_events : MAX_EVENTS, timeout_ms);
+    for(int i = 0; i < n; i++)
+    {
+        events[i].fd = ready[i].data.fd;
+        events[i].readable = (ready[i].events & EPOLLIN) != 0;
+        events[i].writable = (ready[i].events & EPOLLOUT) != 0;
+        events[i].hangup = (ready[i].events & (EPOLLHUP | EPOLLERR)) != 0;
+    }
+    return n;
+}
+
+#else
+
+static bool poller_init(poller *p)
+{
+    p->fds.clear();
+    p->slots.clear();
+    return true;
+}
+
+static void poller_destroy(poller *p)
+{
+    p->fds.clear();
+    p->slots.clear();
+}
+
+static bool poller_set(poller *p, int fd, int interest, bool add)
+{
+    size_t ufd = static_cast<size_t>(fd);
+    if(add)
+    {
+        if(p->slots.size() <= ufd)
+            p->slots.resize(ufd + 1, -1);
+        struct pollfd pfd;
+        memset(&pfd, 0, sizeof pfd);
+        pfd.fd = fd;
+        p->slots[ufd] = static_cast<int>(p->fds.size());
+        p->fds.push_back(pfd);
+    }
+    if(ufd >= p->slots.size() || p->slots[ufd] == -1)
+        return false;
+    struct pollfd *pfd = &p->fds[static_cast<size_t>(p->slots[ufd])];
+    pfd->events = 0;
+    if(interest & POLL_READ)
+        pfd->events |= POLLIN;
+    if(interest & POLL_WRITE)
+        pfd->events |= POLLOUT;
+    return true;
+}
+
+static void poller_remove(poller *p, int fd)
+{
+    size_t ufd = static_cast<size_t>(fd);
+    if(ufd >= p->slots.size() || p->slots[ufd] == -1)
+        return;
+    size_t slot = static_cast<size_t>(p->slots[ufd]);
+    p->fds[slot] = p->fds.back();
+    p->slots[static_cast<size_t>(p->fds[slot].fd)] = static_cast<int>(slot);
+    p->fds.pop_back();
+    p->slots[ufd] = -1;
+}
+
+static int poller_wait(poller *p, poll_event *events, int max_events, int timeout_ms)
+{
+    int r = poll(p->fds.data(), static_cast<nfds_t>(p->fds.size()), timeout_ms);
+    if(r <= 0)
+        return r;
+    int n = 0;
+    for(size_t i = 0; i < p->fds.size() && n < max_events; i++)
+    {
+        short revents = p->fds[i].revents;
+        if(revents == 0)
+            continue;
+        events[n].fd = p->fds[i].fd;
+        events[n].readable = (revents & POLLIN) != 0;
+        events[n].writable = (revents & POLLOUT) != 0;
+        events[n].hangup = (revents & (POLLHUP | POLLERR | POLLNVAL)) != 0;
+        n++;
+    }
+    return n;
+}
+
+#endif
+
+static void connection_set_interest(server *s, connection *conn, int interest)
+{
+    if(conn->interest == interest)
+        return;
+    poller_set(&s->events, conn->fd, interest, false);
+    conn->interest = interest;
+}
+
+static void connection_close(server *s, connection *conn)
+{
+    poller_remove(&s->events, conn->fd);
+    close(conn->fd);
+    s->connections[static_cast<size_t>(conn->fd)] = nullptr;
+    read_buffer_free(&conn->in);
+    arena_free(&conn->scratch);
+    response_stream_end(&conn->stream);
+    delete conn;
+}
+
+/**
+ * Answers a request whose body can't be taken, and closes the connection
+ * after it since the rest of the body would be read as the next request.
+ */
+static bool connection_reject_body(connection *conn, enum HTTP_Code code)
+{
+    conn->keep_alive = false;
+    generate_response(conn, conn->header_info.version, code, Text_HTML, "");
+    metrics_request(ROUTE_OTHER, conn->header_info.verb, code, 0);
+    request_body_reset(&conn->body);
+    arena_reset(&conn->scratch);
+    return true;
+}
+
+/**
+ * Moves the header out of the input buffer so the buffer can be emptied
+ * while a body that doesn't fit in it is received.
+ */
+static void connection_keep_header(connection *conn)
+{
+    conn->header_store.assign(read_buffer_data(&conn->in), conn->header_length);
+    memset(&conn->header_info, 0, sizeof(struct header_info_s));
+    parse_header(conn->header_store.data(), conn->header_store.length(), &conn->header_info); //parsed the same way the first time
+}
+
+static void accept_connections(server *s)
+{
+    while(true)
+    {
+        int fd = accept(s->sd->socket, nullptr, nullptr);
+        if(fd == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            return;
+        }
+        if(!set_nonblocking(fd))
+        {
+            perror("fcntl");
+            close(fd);
+            continue;
+        }
+
+        connection *conn = new connection();
+        conn->fd = fd;
+        conn->interest = POLL_READ;
+        conn->state = CONN_READING_HEADER;
+        conn->keep_alive = false;
+        conn->peer_closed = false;
+        conn->last_active = monotonic_ms();
+        conn->accepted_at = monotonic_ns();
+        conn->first_byte_sent = false;
+        conn->queued_at = 0;
+        conn->route = ROUTE_OTHER;
+        conn->code = UNKNOWN_HTTP_CODE;
+        read_buffer_init(&conn->in, READ_BUFFER_MAX_SIZE);
+        conn->header_length = 0;
+        conn->body_start = 0;
+        request_body_reset(&conn->body);
+        write_queue_init(&conn->out);
+        arena_init(&conn->scratch);
+        conn->stream.produce = nullptr;
+        conn->stream.z = nullptr;
+        memset(&conn->header_info, 0, sizeof(struct header_info_s));
+
+        if(!poller_set(&s->events, fd, POLL_READ, true))
+        {
+            perror("poller_set");
+            close(fd);
+            read_buffer_free(&conn->in);
+            delete conn;
+            continue;
+        }
+        size_t ufd = static_cast<size_t>(fd);
+        if(s->connections.size() <= ufd)
+            s->connections.resize(ufd + 1, nullptr);
+        s->connections[ufd] = conn;
+    }
+}
+
+/**
+ * Pulls what the kernel has for this connection into its input buffer with
+ * one large recv(); anything left over wakes the (level triggered) poller again.
+ * Returns false if the peer has gone away.
+ */
+static bool connection_read(connection *conn)
+{
+    enum Read_Status r = read_buffer_fill(&conn->in, conn->fd);
+    return r == READ_OK || r == READ_AGAIN;
+}
+
+/**
+ * Writes as much of the queued output as the socket will take.
+ * Returns false on a write error.
+ */
+static bool connection_flush(connection *conn)
+{
+    size_t pending = write_queue_pending(&conn->out);
+    enum Write_Status w = write_queue_flush(&conn->out, conn->fd);
+    if(write_queue_pending(&conn->out) != pending)
+    {
+        conn->last_active = monotonic_ms();
+        if(!conn->first_byte_sent)
+        {
+            conn->first_byte_sent = true;
+            metrics_phase(PHASE_FIRST_BYTE, monotonic_ns() - conn->accepted_at);
+        }
+    }
+    if(w != WRITE_DONE)
+        return w == WRITE_AGAIN;
+    if(conn->queued_at != 0 && conn->state != CONN_PRODUCING) //a streamed body isn't written until it's all been produced
+    {
+        metrics_phase(PHASE_WRITE, monotonic_ns() - conn->queued_at);
+        conn->queued_at = 0;
+    }
+    if(conn->state == CONN_WRITING)
+        conn->state = conn->keep_alive ? CONN_READING_HEADER : CONN_CLOSING;
+    return true;
+}
+
+/**
+ * Tries to frame and handle one request from the input buffer.
+ * Returns true once a response for it has been queued, false if more input is needed.
+ */
+static bool connection_handle_next(server *s, connection *conn)
+{
+    if(conn->state == CONN_READING_HEADER)
+    {
+        size_t header_length = read_buffer_find_header_end(&conn->in);
+        if(header_length == 0)
+        {
+            if(read_buffer_length(&conn->in) > MAX_HEADER_SIZE)
+            {
+                conn->keep_alive = false;
+                generate_response(conn, HTTP_V1_1, _400_Bad_Request, Text_HTML, "");
+                metrics_request(ROUTE_OTHER, HTTP_UNKNOWN, _400_Bad_Request, 0);
+                return true;
+            }
+            return false;
+        }
+        conn->header_length = header_length;
+
+        uint64_t queued = ns_since(&conn->in.received);
+        if(queued != 0)
+            metrics_phase(PHASE_QUEUED, queued);
+        uint64_t parse_start = monotonic_ns();
+        memset(&conn->header_info, 0, sizeof(struct header_info_s));
+        bool parsed = parse_header(read_buffer_data(&conn->in), header_length, &conn->header_info);
+        metrics_phase(PHASE_PARSE, monotonic_ns() - parse_start);
+        if(!parsed)
+        {
+            conn->keep_alive = false; //can't trust the framing of anything after this
+            generate_response(conn, HTTP_V1_1, _400_Bad_Request, Text_HTML, "");
+            metrics_request(ROUTE_OTHER, conn->header_info.verb, _400_Bad_Request, 0);
+            return true;
+        }
+        conn->keep_alive = conn->header_info.keep_alive;
+        conn->state = CONN_READING_BODY;
+        conn->body_start = header_length;
+        if(request_body_begin(&conn->body, conn->header_info.chunked, conn->header_info.content_length, s->max_body_size) == BODY_TOO_LARGE)
+            return connection_reject_body(conn, _413_Payload_Too_Large);
+        if(conn->header_info.expect_continue && conn->header_info.version == HTTP_V1_1 && read_buffer_length(&conn->in) == header_length)
+            write_queue_append_str(&conn->out, "HTTP/1.1 100 Continue\r\n\r\n");
+    }
+
+    //decode whatever part of the body has arrived
+    size_t used;
+    enum Body_Status body = request_body_feed(&conn->body, read_buffer_data(&conn->in) + conn->body_start, read_buffer_length(&conn->in) - conn->body_start, &used);
+    conn->body_start += used;
+    if(body == BODY_TOO_LARGE)
+        return connection_reject_body(conn, _413_Payload_Too_Large);
+    if(body == BODY_MALFORMED)
+        return connection_reject_body(conn, _400_Bad_Request);
+    if(body == BODY_MORE)
+    {
+        if(conn->header_store.empty())
+            connection_keep_header(conn);
+        read_buffer_consume(&conn->in, conn->body_start);
+        conn->body_start = 0;
+        return false; //wait for the rest of it
+    }
+    if(conn->header_info.chunked)
+        conn->header_info.content_length = static_cast<int>(conn->body.data.size());
+
+#ifdef ALLOC_STATS
+    uint64_t allocations = alloc_stats_count();
+#endif
+    uint64_t start = monotonic_ns();
+    uint64_t whiteboard_before = metrics_local()->whiteboard_ns;
+    conn->route = ROUTE_OTHER;
+    conn->code = UNKNOWN_HTTP_CODE; //set by whichever response the handler starts
+    handle_request(conn, s->wbd, &conn->header_info, &conn->body.data[0]);
+    if(conn->state != CONN_WRITING && conn->state != CONN_STREAMING && conn->state != CONN_PRODUCING) //handler did not produce a response
+        generate_response(conn, conn->header_info.version, _501_Not_Implemented, Text_HTML, "");
+    uint64_t handled = monotonic_ns();
+    uint64_t whiteboard = metrics_local()->whiteboard_ns - whiteboard_before;
+    metrics_request(conn->route, conn->header_info.verb, conn->code, handled - start);
+    if(whiteboard != 0)
+        metrics_phase(PHASE_WHITEBOARD, whiteboard);
+    metrics_phase(PHASE_RENDER, handled - start - whiteboard);
+    if(conn->queued_at == 0 && conn->state != CONN_STREAMING)
+        conn->queued_at = handled;
+#ifdef ALLOC_STATS
+    fprintf(stderr, "%.*s: %llu allocations\n", static_cast<int>(conn->header_info.url.length), conn->header_info.url.data,
+            static_cast<unsigned long long>(alloc_stats_count() - allocations));
+#endif
+    read_buffer_consume(&conn->in, conn->body_start); //header_info points into the buffer until now
+    conn->body_start = 0;
+    conn->header_store.clear();
+    request_body_reset(&conn->body);
+    arena_reset(&conn->scratch); //the response has been copied into the write queue
+    return true;
+}
+
+/**
+ * Runs the request state machine over whatever has been buffered so far.
+ * Pipelined requests are answered in order, up to MAX_PIPELINED_REQUESTS
+ * or MAX_PENDING_OUTPUT bytes of responses before the output is drained.
+ */
+static void connection_process(server *s, connection *conn)
+{
+    int handled = 0;
+    while(conn->state == CONN_READING_HEADER || conn->state == CONN_READING_BODY)
+    {
+        if(!connection_handle_next(s, conn))
+            return;
+        if(!conn->keep_alive || conn->state == CONN_STREAMING || conn->state == CONN_PRODUCING)
+            return; //close once this response is out, stay with the event stream, or finish producing the body first
+        if(++handled >= MAX_PIPELINED_REQUESTS || write_queue_pending(&conn->out) >= MAX_PENDING_OUTPUT)
+            return; //resumed by connection_flush() once the backlog is written
+        conn->state = CONN_READING_HEADER;
+    }
+}
+
+/**
+ * Writes whatever is queued, picks up pipelined requests once the backlog
+ * is gone, and updates what the poller watches for.
+ */
+static void connection_drain(server *s, connection *conn)
+{
+    while(!write_queue_empty(&conn->out) || conn->state == CONN_WRITING || conn->state == CONN_PRODUCING)
+    {
+        if(conn->state == CONN_PRODUCING)
+        {
+            response_stream_fill(conn, s->wbd); //top the output back up to the low water mark
+            arena_reset(&conn->scratch);
+        }
+        if(!connection_flush(conn))
+        {
+            connection_close(s, conn);
+            return;
+        }
+        if(!write_queue_empty(&conn->out))
+            break; //socket is full, wait until it is writable
+        if(conn->state == CONN_PRODUCING)
+            continue;
+        if(conn->state != CONN_READING_HEADER || read_buffer_length(&conn->in) == 0)
+            break;
+        connection_process(s, conn); //pipelined requests held back by the backlog
+    }
+
+    if(conn->state == CONN_CLOSING || (conn->peer_closed && write_queue_empty(&conn->out)))
+    {
+        connection_close(s, conn);
+        return;
+    }
+
+    int interest = write_queue_empty(&conn->out) ? POLL_NONE : POLL_WRITE;
+    if(conn->state != CONN_WRITING && conn->state != CONN_PRODUCING)
+        interest |= POLL_READ;
+    connection_set_interest(s, conn, interest);
+}
+
+static void connection_event(server *s, connection *conn, poll_event *ev)
+{
+    if((conn->state == CONN_READING_HEADER || conn->state == CONN_READING_BODY) && (ev->readable || ev->hangup))
+    {
+        if(!connection_read(conn))
+            conn->peer_closed = true;
+        conn->last_active = monotonic_ms();
+        connection_process(s, conn);
+    }
+    else if(conn->state == CONN_STREAMING && (ev->readable || ev->hangup))
+    {
+        //event stream clients have nothing more to say, so this is them leaving
+        bool open = connection_read(conn);
+        read_buffer_consume(&conn->in, read_buffer_length(&conn->in));
+        if(!open)
+        {
+            connection_close(s, conn);
+            return;
+        }
+    }
+
+    connection_drain(s, conn);
+}
+
+/**
+ * Pushes changed values to every event stream, dropping subscribers that
+ * have stopped reading.  What a stream holds is checked as well as what it
+ * has still to send, so one that never quite drains can't grow either.
+ */
+static void update_event_streams(server *s)
+{
+    for(size_t i = 0; i < s->connections.size(); i++)
+    {
+        connection *conn = s->connections[i];
+        if(!conn || conn->state != CONN_STREAMING)
+            continue;
+        if(write_queue_pending(&conn->out) > EVENT_STREAM_MAX_BACKLOG || write_queue_retained(&conn->out) > EVENT_STREAM_MAX_BACKLOG)
+        {
+            connection_close(s, conn);
+            continue;
+        }
+        size_t queued = write_queue_pending(&conn->out);
+        event_stream_update(conn, s->wbd, &s->stream_cache);
+        if(write_queue_pending(&conn->out) != queued)
+            connection_drain(s, conn);
+    }
+}
+
+/**
+ * Closes connections that have not made progress within the idle timeout,
+ * whether they are idle keep-alive connections, stalled mid-request or
+ * event streams that aren't being read.
+ */
+static void close_idle_connections(server *s, uint64_t now, uint64_t timeout_ms)
+{
+    for(size_t i = 0; i < s->connections.size(); i++)
+    {
+        connection *conn = s->connections[i];
+        if(!conn || now - conn->last_active <= timeout_ms)
+            continue;
+        if(conn->state == CONN_STREAMING && write_queue_empty(&conn->out))
+            continue; //quiet, but still subscribed
+        connection_close(s, conn);
+    }
+}
+
+/** Starts listening on the worker's socket (unless it is shared) and polling it. */
+static bool worker_listen(server *s, bool shared)
+{
+    if(!shared && (listen(s->sd->socket, SOMAXCONN) == -1 || !set_nonblocking(s->sd->socket)))
+    {
+        perror("listen");
+        return false;
+    }
+    if(!poller_init(&s->events))
+    {
+        perror("poller_init");
+        return false;
+    }
+    if(!poller_set(&s->events, s->sd->socket, POLL_READ, true))
+    {
+        perror("poller_set");
+        poller_destroy(&s->events);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Runs one event loop until the server is shut down.  Everything it touches,
+ * its connections, poller and whiteboard descriptor, belongs to the calling
+ * thread.  'shared' is the listening socket to use, or nullptr for the worker
+ * to bind its own SO_REUSEPORT listener.  A worker that can't start frees
+ * what it had, counts itself in 'failed' and shuts the other workers down,
+ * rather than leaving the server running one worker short.
+ */
+static void worker_run(const server_options *options, socket_descriptor *shared, std::atomic<int> *failed)
+{
+    server s;
+    s.sd = shared ? shared : init_socket(options->port, options->threads > 1);
+    s.wbd = gsw_new_whiteboard(options->wbname);
+    s.max_body_size = options->max_body_size;
+    uint64_t timeout_ms = static_cast<uint64_t>(options->idle_timeout) * 1000;
+    uint64_t last_sweep = monotonic_ms();
+    uint64_t last_stream_update = last_sweep;
+
+    if(!worker_listen(&s, shared != nullptr))
+    {
+        if(!shared)
+            close_socket(s.sd);
+        if(s.wbd)
+            gsw_free_whiteboard(s.wbd);
+        failed->fetch_add(1);
+        aborting_server.store(true);
+        return;
+    }
+
+    poll_event events[MAX_EVENTS];
+
+    while (!aborting_server)
+    {
+        int n = poller_wait(&s.events, &events[0], MAX_EVENTS, EVENT_STREAM_INTERVAL_MS);
+        if(n == -1 && errno != EINTR)
+        {
+            perror("poller_wait");
+            break;
+        }
+        for(int i = 0; i < n; i++)
+        {
+            if(events[i].fd == s.sd->socket)
+            {
+                accept_connections(&s);
+                continue;
+            }
+            size_t ufd = static_cast<size_t>(events[i].fd);
+            connection *conn = ufd < s.connections.size() ? s.connections[ufd] : nullptr;
+            if(conn)
+                connection_event(&s, conn, &events[i]);
+        }
+
+        uint64_t now = monotonic_ms();
+        if(now - last_stream_update >= EVENT_STREAM_INTERVAL_MS)
+        {
+            update_event_streams(&s);
+            last_stream_update = now;
+        }
+        if(now - last_sweep >= SWEEP_INTERVAL_MS)
+        {
+            close_idle_connections(&s, now, timeout_ms);
+            last_sweep = now;
+        }
+    }
+
+    for(size_t i = 0; i < s.connections.size(); i++)
+        if(s.connections[i])
+            connection_close(&s, s.connections[i]);
+    poller_destroy(&s.events);
+    if(!shared)
+        close_socket(s.sd);
+    if (s.wbd) gsw_free_whiteboard(s.wbd);
+}
+
+/** The types named in a comma separated option, every type for "all". */
+static std::vector<int> option_types(const char *names)
+{
+    std::vector<int> types(GSW_NUM_TYPES_DEFINED);
+    size_t count = 0;
+    if(strcmp(names, "all") == 0)
+        for(int i = 1; i < GSW_NUM_TYPES_DEFINED; i++)
+            types[count++] = i;
+    else
+    {
+        http_string list = { names, strlen(names) };
+        count = wb_find_types(list, &types[0], types.size());
+    }
+    types.resize(count);
+    return types;
+}
+
+/** Starts the threads that work alongside the workers: post queue, history, recorder and replay. */
+static bool start_background(const server_options *options)
+{
+    if(options->post_rate > 0 && !post_queue_start(options->wbname, options->post_rate))
+    {
+        fprintf(stderr, "Could not start the post queue\n");
+        return false;
+    }
+    if(options->history_types)
+    {
+        std::vector<int> types = option_types(options->history_types);
+        if(!history_start(options->wbname, types.data(), types.size(), options->history_size))
+        {
+            fprintf(stderr, "Could not start recording history\n");
+            return false;
+        }
+    }
+    if(options->record_path && options->replay_path && strcmp(options->record_path, options->replay_path) == 0)
+    {
+        fprintf(stderr, "Can't record to the recording being replayed\n");
+        return false;
+    }
+    if(options->record_path)
+    {
+        std::vector<int> types = option_types(options->record_types);
+        if(!recorder_start(options->wbname, options->record_path, types.data(), types.size()))
+        {
+            fprintf(stderr, "Could not start recording to '%s'\n", options->record_path);
+            return false;
+        }
+    }
+    if(options->replay_path && !replay_start(options->wbname, options->replay_path))
+    {
+        fprintf(stderr, "Could not open '%s' for replay\n", options->replay_path);
+        return false;
+    }
+    return true;
+}
+
+static void stop_background(void)
+{
+    replay_stop();
+    recorder_stop();
+    history_stop();
+    post_queue_stop(); //posts anything still queued
+}
+
+bool serverd(const server_options *options)
+{
+    int workers = options->threads > 1 ? options->threads : 1;
+#ifdef __linux__
+    //every worker binds its own listener and the kernel spreads new connections across them
+    socket_descriptor *shared = nullptr;
+#else
+    //SO_REUSEPORT doesn't balance connections here, so the workers take turns accepting from one listener
+    socket_descriptor *shared = init_socket(options->port, false);
+    if(listen(shared->socket, SOMAXCONN) == -1 || !set_nonblocking(shared->socket))
+    {
+        perror("listen");
+        close_socket(shared);
+        return false;
+    }
+#endif
+
+    wb_types_init();
+    compress_init(options->compression_level);
+    assets_init();
+    if(!start_background(options))
+    {
+        stop_background();
+        if(shared)
+            close_socket(shared);
+        return false;
+    }
+    std::atomic<int> failed(0);
+    std::vector<std::thread> threads;
+    for(int i = 1; i < workers; i++)
+        threads.push_back(std::thread(worker_run, options, shared, &failed));
+    worker_run(options, shared, &failed); //the calling thread is the first worker
+
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    stop_background();
+    if(shared)
+        close_socket(shared);
+    if(failed.load() > 0)
+    {
+        fprintf(stderr, "%d of %d workers could not start, the server was shut down\n", failed.load(), workers);
+        return false;
+    }
+    return true;
+}
+
+socket_descriptor *init_socket(int port, bool reuseport)
+{
+    socket_descriptor *sd = static_cast<socket_descriptor *>(calloc(sizeof(socket_descriptor), 1));
+    assert(sd);
+
+    //modified from: http://beej.us/guide/bgnet/examples/listener.c
+    struct addrinfo hints, *servinfo, *p;
+    int rv;
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE; // use my IP
+
+    char port_s[6];
+    snprintf(&port_s[0], sizeof(port_s), "%d", port);
+
+    assert ((rv = getaddrinfo(nullptr, &port_s[0], &hints, &servinfo)) == 0);
+
+    // loop through all the results and bind to the first we can
+    for(p = servinfo; p != nullptr; p = p->ai_next)
+    {
+        if ((sd->socket = socket(p->ai_family, p->ai_socktype, 0)) == -1)
+        {
+            perror("listener: socket");
+            continue;
+        }
+
+        int on = 1;
+
+        assert(!(setsockopt(sd->socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0));
+
+#ifdef SO_REUSEPORT
+        if (reuseport && setsockopt(sd->socket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+            perror("listener: SO_REUSEPORT");
+#endif
+
+        assert(!(setsockopt(sd->socket, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0));
+
+        if (bind(sd->socket, p->ai_addr, p->ai_addrlen) == -1) {
+            close(sd->socket);
+            perror("listener: bind");
+            continue;
+        }
+        break;
+    }
+
+    assert (p != nullptr);
+
+    freeaddrinfo(servinfo);
+
+    return sd;
+}
+
+void close_socket(socket_descriptor *sd)
+{
+    if(sd)
+    {
+        if(sd->socket)
+            close(sd->socket);
+        free(sd);
+    }
+}
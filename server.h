@@ -0,0 +1,66 @@
+/**
+ *  /file guwhiteboardwebposter/server.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "guwhiteboardwebposter.h"
+#include "metrics.h"
+#include "read_buffer.h"
+#include "request_body.h"
+#include "response_stream.h"
+#include "write_queue.h"
+
+#define MAX_HEADER_SIZE 8192    ///< requests with a larger header are rejected
+#define READ_BUFFER_MAX_SIZE (4 * MAX_HEADER_SIZE) ///< room for a full header plus what follows it, bodies are moved out as they arrive
+
+/** where a connection is up to in its request/response cycle */
+enum Connection_State
+{
+    CONN_READING_HEADER = 0,    ///< waiting for a complete request header
+    CONN_READING_BODY,          ///< header parsed, decoding the body as it arrives
+    CONN_WRITING,               ///< response queued, draining it before reading the next request
+    CONN_PRODUCING,             ///< streaming a generated body, more of it is produced as 'out' drains
+    CONN_STREAMING,             ///< sending 'text/event-stream' events until the client goes away
+    CONN_CLOSING                ///< done, the event loop will close the socket
+};
+
+/** per client connection state, owned by the event loop */
+typedef struct connection_s
+{
+    int fd;                             ///< client socket, non-blocking
+    int interest;                       ///< readiness events currently registered for fd
+    enum Connection_State state;        ///< parse/write state machine
+    bool keep_alive;                    ///< keep the connection open after the current response
+    bool peer_closed;                   ///< client has shut down its side, close once output is written
+    uint64_t last_active;               ///< monotonic ms of the last read or write progress
+    uint64_t accepted_at;               ///< monotonic ns of accept(), for the time to the first response byte
+    bool first_byte_sent;               ///< the connection has written some of a response
+    uint64_t queued_at;                 ///< monotonic ns responses started queueing up, 0 once they've been written
+    enum Metrics_Route route;           ///< what the current request is for, set while routing it
+    enum HTTP_Code code;                ///< status of the last response header queued
+    read_buffer in;                     ///< received bytes that have not been consumed yet
+    size_t header_length;               ///< length of the current header, including the blank line
+    struct header_info_s header_info;   ///< parsed header of the current request
+    std::string header_store;           ///< the header, once it has to be moved out of 'in' to make room for a large body
+    size_t body_start;                  ///< where the undecoded part of the body starts in 'in'
+    request_body body;                  ///< body of the current request
+    write_queue out;                    ///< response bytes still to be written
+    arena scratch;                      ///< memory for building the current response, reset after every request
+    response_stream stream;             ///< body still being produced, in CONN_PRODUCING
+    std::vector<int> stream_types;      ///< whiteboard types an event stream is subscribed to
+    std::vector<uint16_t> stream_counters; ///< event counter of each subscribed type when it was last sent
+} connection;
+
+#endif //SERVER_H
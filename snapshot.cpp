@@ -0,0 +1,88 @@
+/**
+ *  /file guwhiteboardwebposter/snapshot.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "gusimplewhiteboard.h"
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "cbor.h"
+#include "json.h"
+#include "server.h"
+#include "snapshot.h"
+#include "wb_types.h"
+
+void handle_snapshot(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header)
+{
+    arena *scratch = &conn->scratch;
+    int *types = static_cast<int *>(arena_alloc(scratch, GSW_NUM_TYPES_DEFINED * sizeof(int)));
+    size_t count = 0;
+    http_string filter;
+    if(http_query_param(header->url, "types", &filter) && filter.length > 0)
+        count = wb_find_types(filter, types, GSW_NUM_TYPES_DEFINED);
+    else
+        for(int i = 1; i < GSW_NUM_TYPES_DEFINED; i++)
+            types[count++] = i;
+    size_t parsable = 0;
+    for(size_t i = 0; i < count; i++)
+        if(wb_type(types[i])->parsable)
+            types[parsable++] = types[i];
+    count = parsable;
+
+    gu_simple_message *messages = static_cast<gu_simple_message *>(arena_alloc(scratch, count * sizeof(gu_simple_message)));
+    uint16_t *counters = static_cast<uint16_t *>(arena_alloc(scratch, count * sizeof(uint16_t)));
+    wb_snapshot(wbd, types, count, messages, counters);
+
+    arena_text response;
+    arena_text_init(&response, scratch);
+    if(header->accept == Application_cbor)
+    {   //{"types": [{"type": name, "event_counter": n, "value": text}, ...]}
+        cbor_put_map(&response, 1);
+        cbor_put_text_str(&response, "types");
+        cbor_put_array(&response, count);
+        for(size_t i = 0; i < count; i++)
+        {
+            const wb_type_info *info = wb_type(types[i]);
+            cbor_put_map(&response, 3);
+            cbor_put_text_str(&response, "type");
+            arena_text_append(&response, info->cbor_name.data(), info->cbor_name.length());
+            cbor_put_text_str(&response, "event_counter");
+            cbor_put_uint(&response, counters[i]);
+            cbor_put_text_str(&response, "value");
+            char *value = whiteboard_getmsg(types[i], &messages[i]);
+            cbor_put_text_str(&response, value);
+            free(value);
+        }
+        body_part body = { response.data, response.length, false };
+        generate_response_parts(conn, header->version, _200_OK, Content_Type_Strings[Application_cbor], &body, 1, "Cache-Control: no-cache\r\n");
+        return;
+    }
+    arena_text_append_str(&response, "{\"types\":[\r\n");
+    for(size_t i = 0; i < count; i++)
+    {
+        const wb_type_info *info = wb_type(types[i]);
+        if(i > 0)
+            arena_text_append_str(&response, ",\r\n");
+        arena_text_append_str(&response, "\t{\"type\":");
+        arena_text_append(&response, info->json_name.data(), info->json_name.length());
+        char number[32];
+        int n = snprintf(number, sizeof(number), ", \"event_counter\":%u, \"value\":", static_cast<unsigned>(counters[i]));
+        arena_text_append(&response, number, static_cast<size_t>(n));
+        char *value = whiteboard_getmsg(types[i], &messages[i]);
+        json_append_string(&response, value);
+        free(value);
+        arena_text_append_str(&response, "}");
+    }
+    arena_text_append_str(&response, "\r\n]}");
+
+    enum Content_Type type = header->accept == Application_vnd_api_json ? Application_vnd_api_json : Application_json;
+    body_part body = { response.data, response.length, false };
+    generate_response_parts(conn, header->version, _200_OK, Content_Type_Strings[type], &body, 1, "Cache-Control: no-cache\r\n");
+}
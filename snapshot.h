@@ -0,0 +1,21 @@
+/**
+ *  /file guwhiteboardwebposter/snapshot.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "guwhiteboardwebposter.h"
+
+/**
+ * GET /snapshot?types=A,B,... answers the current value of every parsable
+ * type (or just the listed ones) in one JSON or CBOR document.  All of the slots are
+ * copied under a single whiteboard lock before any of them is serialised.
+ */
+void handle_snapshot(struct connection_s *conn, gu_simple_whiteboard_descriptor *wbd, struct header_info_s *header);
+
+#endif //SNAPSHOT_H
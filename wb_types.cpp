@@ -0,0 +1,225 @@
+/**
+ *  /file guwhiteboardwebposter/wb_types.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "guwhiteboardtypelist_generated.h"
+#include "guwhiteboardgetter.h"
+
+#include "cbor.h"
+#include "json.h"
+#include "metrics.h"
+#include "name_index.h"
+#include "wb_types.h"
+
+static std::vector<wb_type_info> type_table;
+static name_index type_names;
+
+/** Entity for a character that can't appear as itself in HTML text or attribute values, nullptr for the rest. */
+static inline const char *html_entity(char c)
+{
+    switch(c)
+    {
+        case '&': return "&amp;";
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '"': return "&quot;";
+        case '\'': return "&#39;";
+        default: return nullptr;
+    }
+}
+
+static std::string html_escape(const char *s)
+{
+    std::string escaped;
+    for(; *s != '\0'; s++)
+    {
+        const char *entity = html_entity(*s);
+        if(entity)
+            escaped.append(entity);
+        else
+            escaped.push_back(*s);
+    }
+    return escaped;
+}
+
+void html_append_escaped(arena_text *out, const char *s, size_t length)
+{
+    //runs of plain characters are appended in one go
+    size_t start = 0;
+    for(size_t i = 0; i < length; i++)
+    {
+        const char *entity = html_entity(s[i]);
+        if(!entity)
+            continue;
+        arena_text_append(out, s + start, i - start);
+        arena_text_append_str(out, entity);
+        start = i + 1;
+    }
+    arena_text_append(out, s + start, length - start);
+}
+
+void wb_types_init(void)
+{
+    type_table.resize(GSW_NUM_TYPES_DEFINED);
+    for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+    {
+        wb_type_info *info = &type_table[static_cast<size_t>(i)];
+        info->name = WBTypes_stringValues[i];
+        info->index = i;
+        gu_simple_message empty;
+        memset(&empty, 0, sizeof(empty));
+        char *s = whiteboard_getmsg(i, &empty);
+        info->parsable = strcmp(s, "##unsupported##") != 0;
+        free(s);
+        info->json_name.clear();
+        json_append_string(&info->json_name, info->name);
+        info->html_name = html_escape(info->name);
+        info->cbor_name = cbor_text(info->name);
+    }
+    name_index_build(&type_names, WBTypes_stringValues, GSW_NUM_TYPES_DEFINED);
+}
+
+const wb_type_info *wb_type(int type)
+{
+    return &type_table[static_cast<size_t>(type)];
+}
+
+int wb_find_type(const char *name, size_t length)
+{
+    return name_index_find(&type_names, name, length);
+}
+
+size_t wb_find_types(http_string list, int *types, size_t max)
+{
+    size_t count = 0;
+    const char *p = list.data;
+    const char *end = list.data + list.length;
+    while(p < end && count < max)
+    {
+        const char *comma = static_cast<const char *>(memchr(p, ',', static_cast<size_t>(end - p)));
+        const char *item_end = comma ? comma : end;
+        int type = wb_find_type(p, static_cast<size_t>(item_end - p));
+        if(type != -1)
+            types[count++] = type;
+        p = item_end + 1;
+    }
+    return count;
+}
+
+void wb_type_value(gu_simple_whiteboard_descriptor *wbd, int type, arena_text *out)
+{
+    uint64_t start = monotonic_ns();
+    char *value = whiteboard_getmsg_from(wbd, type);
+    metrics_whiteboard(start);
+    arena_text_append_str(out, value);
+    free(value);
+}
+
+void wb_type_value_html(gu_simple_whiteboard_descriptor *wbd, int type, arena_text *out)
+{
+    uint64_t start = monotonic_ns();
+    char *value = whiteboard_getmsg_from(wbd, type);
+    metrics_whiteboard(start);
+    html_append_escaped(out, value, strlen(value));
+    free(value);
+}
+
+void wb_type_value_json(gu_simple_whiteboard_descriptor *wbd, int type, arena_text *out)
+{
+    uint64_t start = monotonic_ns();
+    char *value = whiteboard_getmsg_from(wbd, type);
+    metrics_whiteboard(start);
+    json_append_string(out, value);
+    free(value);
+}
+
+bool wb_post(gu_simple_whiteboard_descriptor *wbd, int type, const std::string &value)
+{
+    uint64_t start = monotonic_ns();
+    bool posted = guWhiteboard::postmsg(static_cast<WBTypes>(type), value, wbd);
+    metrics_whiteboard(start);
+    return posted;
+}
+
+uint16_t wb_type_event_counter(gu_simple_whiteboard_descriptor *wbd, int type)
+{
+    return wbd->wb->event_counters[type];
+}
+
+static void copy_slots(gu_simple_whiteboard_descriptor *wbd, const int *types, size_t count, gu_simple_message *messages, uint16_t *counters)
+{
+    gu_simple_whiteboard *wb = wbd->wb;
+    gsw_procure(wbd->sem, GSW_SEM_PUTMSG);
+    for(size_t i = 0; i < count; i++)
+    {
+        messages[i] = *gsw_current_message(wb, types[i]);
+        counters[i] = wb->event_counters[types[i]];
+    }
+    gsw_vacate(wbd->sem, GSW_SEM_PUTMSG);
+}
+
+void wb_snapshot(gu_simple_whiteboard_descriptor *wbd, const int *types, size_t count, gu_simple_message *messages, uint16_t *counters)
+{
+    uint64_t start = monotonic_ns();
+    copy_slots(wbd, types, count, messages, counters);
+    metrics_whiteboard(start);
+}
+
+void wb_copy_slot(gu_simple_whiteboard_descriptor *wbd, int type, gu_simple_message *message, uint16_t *counter)
+{
+    copy_slots(wbd, &type, 1, message, counter);
+}
+
+void wb_write_slot(gu_simple_whiteboard_descriptor *wbd, int type, const void *data, size_t length)
+{
+    uint64_t start = monotonic_ns();
+    gu_simple_whiteboard *wb = wbd->wb;
+    gsw_procure(wbd->sem, GSW_SEM_PUTMSG);
+    gu_simple_message *m = gsw_next_message(wb, type);
+    memset(m, 0, sizeof(*m));
+    memcpy(m, data, length < sizeof(*m) ? length : sizeof(*m));
+    gsw_increment(wb, type);
+    gsw_increment_event_counter(wb, type);
+    gsw_vacate(wbd->sem, GSW_SEM_PUTMSG);
+    gsw_signal_subscribers(wb);
+    metrics_whiteboard(start);
+}
+
+void wb_type_etag(gu_simple_whiteboard_descriptor *wbd, int type, enum Content_Type representation, enum Content_Encoding encoding, char *etag, size_t size)
+{
+    gu_simple_whiteboard *wb = wbd->wb;
+    snprintf(etag, size, "\"%d.%d.%u.%u%s\"", static_cast<int>(representation), type,
+             static_cast<unsigned>(wb->event_counters[type]), static_cast<unsigned>(wb->indexes[type]), Content_Encoding_ETag_Suffixes[encoding]);
+}
+
+void wb_all_types_etag(gu_simple_whiteboard_descriptor *wbd, enum Content_Type representation, enum Content_Encoding encoding, char *etag, size_t size)
+{
+    //FNV-1a over every type's event counter and generation index
+    gu_simple_whiteboard *wb = wbd->wb;
+    uint64_t hash = 14695981039346656037ULL;
+    for(int i = 0; i < GSW_NUM_TYPES_DEFINED; i++)
+    {
+        uint32_t state = static_cast<uint32_t>(wb->event_counters[i]) << 16 | wb->indexes[i];
+        for(int b = 0; b < 4; b++)
+        {
+            hash ^= (state >> (b * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    snprintf(etag, size, "\"%d.all.%016llx%s\"", static_cast<int>(representation), static_cast<unsigned long long>(hash), Content_Encoding_ETag_Suffixes[encoding]);
+}
+
+void wb_type_list_etag(enum Content_Type representation, enum Content_Encoding encoding, char *etag, size_t size)
+{
+    static const long started = static_cast<long>(time(nullptr));
+    snprintf(etag, size, "\"%d.list.%d.%lx%s\"", static_cast<int>(representation), GSW_NUM_TYPES_DEFINED, started, Content_Encoding_ETag_Suffixes[encoding]);
+}
@@ -0,0 +1,114 @@
+/**
+ *  /file guwhiteboardwebposter/wb_types.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef WB_TYPES_H
+#define WB_TYPES_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "gusimplewhiteboard.h"
+
+#include "arena.h"
+#include "http_parser.h"
+
+#define WB_ETAG_SIZE 64     ///< big enough for any tag made below, quotes included
+
+/** what's known about a message type, worked out once at startup */
+typedef struct wb_type_info_s
+{
+    const char *name;           ///< WBTypes_stringValues entry
+    int index;                  ///< WBTypes value
+    bool parsable;              ///< has a string getter, i.e. doesn't serialise to '##unsupported##'
+    std::string json_name;      ///< name as a quoted JSON string
+    std::string html_name;      ///< name escaped for HTML text and attribute values
+    std::string cbor_name;      ///< name as a CBOR text string
+} wb_type_info;
+
+/**
+ * Builds the type table, probing each type's getter once with an empty
+ * message, and the name index.  Call before any worker starts.
+ */
+void wb_types_init(void);
+
+/** Appends 'length' bytes of 's' escaped for HTML text and attribute values. */
+void html_append_escaped(arena_text *out, const char *s, size_t length);
+
+/** Table entry for a valid type index. */
+const wb_type_info *wb_type(int type);
+
+/**
+ * Index of the message type called 'name', or -1 if there isn't one.
+ * A perfect hash lookup, so it costs the same for every type.
+ */
+int wb_find_type(const char *name, size_t length);
+
+/**
+ * Finds the types named in a comma separated list, skipping unknown names.
+ * Returns how many of at most 'max' were stored in 'types'.
+ */
+size_t wb_find_types(http_string list, int *types, size_t max);
+
+/**
+ * Appends a type's current value, serialised by its getter, to 'out'.
+ * The generated getters only hand back malloc()ed strings, so that is the
+ * one heap allocation left on this path; it is freed straight away.
+ */
+void wb_type_value(gu_simple_whiteboard_descriptor *wbd, int type, arena_text *out);
+
+/** Same as wb_type_value(), escaped for HTML text. */
+void wb_type_value_html(gu_simple_whiteboard_descriptor *wbd, int type, arena_text *out);
+
+/** Same as wb_type_value(), as a quoted and escaped JSON string. */
+void wb_type_value_json(gu_simple_whiteboard_descriptor *wbd, int type, arena_text *out);
+
+/** Posts a value through the type's string parser, false if it has none or the value didn't parse. */
+bool wb_post(gu_simple_whiteboard_descriptor *wbd, int type, const std::string &value);
+
+/** Moves on every post to the type, wraps at 65536. */
+uint16_t wb_type_event_counter(gu_simple_whiteboard_descriptor *wbd, int type);
+
+/**
+ * Copies the current message and event counter of each of 'count' types
+ * while holding the put semaphore once, so no post lands part way through.
+ * Serialise the copies afterwards with whiteboard_getmsg().
+ */
+void wb_snapshot(gu_simple_whiteboard_descriptor *wbd, const int *types, size_t count, gu_simple_message *messages, uint16_t *counters);
+
+/**
+ * wb_snapshot() of a single type for background threads, which aren't
+ * handling a request and so aren't timed as one.
+ */
+void wb_copy_slot(gu_simple_whiteboard_descriptor *wbd, int type, gu_simple_message *message, uint16_t *counter);
+
+/**
+ * Replaces a type's value with 'length' bytes of an already encoded
+ * message, the rest of the slot is zeroed.  Done the way the generated
+ * posters do it: the next generation is filled in under the put semaphore,
+ * then made current, and subscribers are signalled.
+ */
+void wb_write_slot(gu_simple_whiteboard_descriptor *wbd, int type, const void *data, size_t length);
+
+/**
+ * Strong entity tag for a type's current value in the given representation,
+ * made from its event counter and generation index so no value is read.
+ * 'encoding' is the coding the body may be sent with, see compress_negotiated(),
+ * so a compressed body never shares a tag with the uncompressed one.
+ */
+void wb_type_etag(gu_simple_whiteboard_descriptor *wbd, int type, enum Content_Type representation, enum Content_Encoding encoding, char *etag, size_t size);
+
+/** Entity tag covering the current value of every type. */
+void wb_all_types_etag(gu_simple_whiteboard_descriptor *wbd, enum Content_Type representation, enum Content_Encoding encoding, char *etag, size_t size);
+
+/** Entity tag for content that only changes with the type list, i.e. when the poster is restarted. */
+void wb_type_list_etag(enum Content_Type representation, enum Content_Encoding encoding, char *etag, size_t size);
+
+#endif //WB_TYPES_H
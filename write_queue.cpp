@@ -0,0 +1,118 @@
+/**
+ *  /file guwhiteboardwebposter/write_queue.cpp
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "write_queue.h"
+
+void write_queue_init(write_queue *q)
+{
+    q->bytes.clear();
+    q->segments.clear();
+    q->head = 0;
+    q->head_written = 0;
+    q->pending = 0;
+}
+
+void write_queue_append(write_queue *q, const char *data, size_t length)
+{
+    if(length == 0)
+        return;
+    //grow the last segment if it ends where the new bytes will go
+    if(q->segments.size() > q->head)
+    {
+        write_segment *last = &q->segments.back();
+        if(last->data == nullptr && last->offset + last->length == q->bytes.length())
+        {
+            q->bytes.append(data, length);
+            last->length += length;
+            q->pending += length;
+            return;
+        }
+    }
+    write_segment segment = { nullptr, q->bytes.length(), length };
+    q->bytes.append(data, length);
+    q->segments.push_back(segment);
+    q->pending += length;
+}
+
+void write_queue_append_borrowed(write_queue *q, const char *data, size_t length)
+{
+    if(length == 0)
+        return;
+    write_segment segment = { data, 0, length };
+    q->segments.push_back(segment);
+    q->pending += length;
+}
+
+/** Drops the written segments, and the bytes before the first one left. */
+static void write_queue_compact(write_queue *q)
+{
+    size_t start = q->bytes.length();
+    for(size_t i = q->head; i < q->segments.size(); i++)
+        if(q->segments[i].data == nullptr)
+        {
+            start = q->segments[i].offset;
+            break;
+        }
+    if(start < WRITE_QUEUE_COMPACT_SIZE && q->head < WRITE_QUEUE_COMPACT_SEGMENTS)
+        return;
+    q->bytes.erase(0, start);
+    q->segments.erase(q->segments.begin(), q->segments.begin() + static_cast<std::ptrdiff_t>(q->head));
+    for(size_t i = 0; i < q->segments.size(); i++)
+        if(q->segments[i].data == nullptr)
+            q->segments[i].offset -= start;
+    q->head = 0;
+}
+
+enum Write_Status write_queue_flush(write_queue *q, int fd)
+{
+    while(q->pending > 0)
+    {
+        struct iovec iov[WRITE_QUEUE_MAX_IOV];
+        int count = 0;
+        for(size_t i = q->head; i < q->segments.size() && count < WRITE_QUEUE_MAX_IOV; i++)
+        {
+            const write_segment *segment = &q->segments[i];
+            const char *data = segment->data ? segment->data : q->bytes.data() + segment->offset;
+            size_t skip = i == q->head ? q->head_written : 0;
+            iov[count].iov_base = const_cast<char *>(data + skip);
+            iov[count].iov_len = segment->length - skip;
+            count++;
+        }
+
+        ssize_t w = writev(fd, iov, count);
+        if(w == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? WRITE_AGAIN : WRITE_ERROR;
+        }
+
+        size_t written = static_cast<size_t>(w);
+        q->pending -= written;
+        while(written > 0)
+        {
+            size_t left = q->segments[q->head].length - q->head_written;
+            if(written < left)
+            {
+                q->head_written += written;
+                break;
+            }
+            written -= left;
+            q->head++;
+            q->head_written = 0;
+        }
+        if(q->pending > 0)
+            write_queue_compact(q);
+    }
+    write_queue_init(q); //keeps the storage for the next response
+    return WRITE_DONE;
+}
@@ -0,0 +1,75 @@
+/**
+ *  /file guwhiteboardwebposter/write_queue.h
+ *
+ *  Created by Carl Lusty in 2016.
+ *  Copyright (c) 2016 Carl Lusty
+ *  All rights reserved.
+ */
+
+#ifndef WRITE_QUEUE_H
+#define WRITE_QUEUE_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define WRITE_QUEUE_MAX_IOV 64      ///< segments handed to one writev()
+#define WRITE_QUEUE_COMPACT_SIZE (16 * 1024) ///< written bytes kept at the front of 'bytes' before they're dropped
+#define WRITE_QUEUE_COMPACT_SEGMENTS 256    ///< written segments kept before they're dropped
+
+/** a run of output, either borrowed or a range of the queue's own bytes */
+typedef struct write_segment_s
+{
+    const char *data;   ///< borrowed bytes, nullptr if the segment is in 'bytes'
+    size_t offset;      ///< where the segment starts in 'bytes' when it isn't borrowed
+    size_t length;
+} write_segment;
+
+/**
+ * Per connection output queue.
+ *
+ * Dynamic output is copied into one growing string, while content that
+ * outlives the connection (static assets, prebuilt page fragments) is only
+ * referenced.  Both are written together with writev(), so a response made
+ * of headers, a static body and a few generated bytes goes out in one call
+ * without being concatenated first.  Once the queue drains its storage is
+ * reused by the next response; while it is still draining, what has been
+ * written is dropped from the front every WRITE_QUEUE_COMPACT_SIZE bytes or
+ * WRITE_QUEUE_COMPACT_SEGMENTS segments, so a stream that never quite
+ * drains only holds what it hasn't written yet.
+ */
+typedef struct write_queue_s
+{
+    std::string bytes;                  ///< copied output
+    std::vector<write_segment> segments;
+    size_t head;                        ///< first segment not completely written
+    size_t head_written;                ///< how much of segments[head] has been written
+    size_t pending;                     ///< bytes still to be written
+} write_queue;
+
+/** result of write_queue_flush() */
+enum Write_Status
+{
+    WRITE_DONE = 0,     ///< everything has been written
+    WRITE_AGAIN,        ///< the socket is full
+    WRITE_ERROR         ///< socket error, errno is set
+};
+
+void write_queue_init(write_queue *q);
+
+/** Queues a copy of length bytes. */
+void write_queue_append(write_queue *q, const char *data, size_t length);
+
+/** Queues length bytes without copying them, they must stay valid until written. */
+void write_queue_append_borrowed(write_queue *q, const char *data, size_t length);
+
+/** Writes as much as the socket will take. */
+enum Write_Status write_queue_flush(write_queue *q, int fd);
+
+inline void write_queue_append_str(write_queue *q, const char *s) { write_queue_append(q, s, strlen(s)); }
+inline size_t write_queue_pending(const write_queue *q) { return q->pending; }
+inline size_t write_queue_retained(const write_queue *q) { return q->bytes.length(); } ///< copied bytes held, written or not
+inline bool write_queue_empty(const write_queue *q) { return q->pending == 0; }
+
+#endif //WRITE_QUEUE_H